@@ -0,0 +1,123 @@
+// Compare the event file layouts: write throughput, file size and read
+// speed of the same events.
+// Usage: event-bench [number of events] [mean hits per event]
+// The events are written by one TEventWriter and read back with
+// TEventReader, as the builder and reader.cpp do.
+
+#include <TROOT.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TEventReader.hpp"
+#include "TEventWriter.hpp"
+
+static constexpr uint64_t kEventsPerBlock = 10000;
+
+static std::vector<std::unique_ptr<TEventBlock>> MakeBlocks(uint64_t nEvents,
+                                                            double meanHits)
+{
+  std::mt19937_64 rng(42);
+  std::poisson_distribution<uint32_t> randomHits(std::max(meanHits - 1., 0.1));
+  std::uniform_int_distribution<Timestamp_t> randomDT(-1000000, 1000000);
+  std::uniform_int_distribution<uint32_t> randomEnergy(0, 16383);
+
+  std::vector<std::unique_ptr<TEventBlock>> blocks;
+  THitStore hits;
+  for (uint64_t i = 0; i < nEvents; i++) {
+    if (i % kEventsPerBlock == 0) {
+      blocks.push_back(std::make_unique<TEventBlock>());
+    }
+
+    // The trigger is the first hit.  Times are in ps.
+    const Timestamp_t triggerTS = Timestamp_t(i) * 10000000;
+    hits.clear();
+    const auto nHits = randomHits(rng) + 1;
+    for (uint32_t k = 0; k < nHits; k++) {
+      const auto dT = k == 0 ? 0 : randomDT(rng);
+      const auto energy = randomEnergy(rng);
+      hits.emplace_back(k % 11, (k * 7) % 16, triggerTS + dT, energy,
+                        energy / 4);
+    }
+    blocks.back()->AddEvent(hits, 0, hits.size(), 0, i % 34, triggerTS,
+                            nHits, nHits / 2, nHits / 4, nHits / 8,
+                            i % 3 == 0);
+  }
+
+  return blocks;
+}
+
+template <class Func>
+static double Measure(Func func)
+{
+  const auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+int main(int argc, char *argv[])
+{
+  uint64_t nEvents = 2000000;
+  double meanHits = 8.;
+  if (argc > 1) nEvents = std::stoull(argv[1]);
+  if (argc > 2) meanHits = std::stod(argv[2]);
+
+  ROOT::EnableThreadSafety();
+
+  std::vector<std::pair<std::string, EventLayout>> layouts = {
+      {"object", EventLayout::Object}, {"flat", EventLayout::Flat}};
+#ifdef USE_RNTUPLE
+  layouts.emplace_back("rntuple", EventLayout::RNTuple);
+#endif
+
+  std::cout << nEvents << " events, " << meanHits << " hits/event"
+            << std::endl;
+  std::cout << "Layout\twrite [s]\twrite [MB/s]\tsize [MB]\tread [s]"
+            << std::endl;
+  for (const auto &[name, layout] : layouts) {
+    const auto fileName = "event_bench_" + name + ".root";
+
+    // The blocks are made outside of the measurement
+    auto blocks = MakeBlocks(nEvents, meanHits);
+    uint64_t nHits = 0;
+    for (const auto &block : blocks) nHits += block->Hits.size();
+
+    const auto writeTime = Measure([&]() {
+      TEventWriter writer(fileName, 4, layout);
+      for (auto &block : blocks) writer.Push(std::move(block));
+      writer.Close();
+    });
+    // Board, Channel, dT, Energy, EnergyShort and the trigger values
+    const double rawMB = (nHits * 14. + nEvents * 14.) / 1024. / 1024.;
+    const double fileMB =
+        std::filesystem::file_size(fileName) / 1024. / 1024.;
+
+    uint64_t nReadHits = 0;
+    double eneSum = 0.;
+    const auto readTime = Measure([&]() {
+      TEventReader reader(fileName);
+      for (Long64_t i = 0; i < reader.GetEntries(); i++) {
+        reader.GetEntry(i);
+        for (const auto &hit : reader.GetEvent()) eneSum += hit.Energy;
+        nReadHits += reader.GetEvent().size();
+      }
+    });
+
+    std::cout << name << "\t" << writeTime << "\t" << rawMB / writeTime
+              << "\t" << fileMB << "\t" << readTime;
+    if (nReadHits != nHits) std::cout << "\tREAD " << nReadHits << " HITS";
+    std::cout << std::endl;
+    std::filesystem::remove(fileName);
+  }
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+// Compare THitStore::SortByTime with the comparison sort used before.
+// Usage: sort-bench [number of hits] [number of runs]
+// The hits are made as in a loaded batch: the given number of time ordered
+// runs (files) one after another, over the same time span.
+// 0 runs: random order.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <parallel/algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "THitStore.hpp"
+
+static THitStore MakeHits(uint64_t nHits, uint32_t nRuns)
+{
+  THitStore hits;
+  hits.resize(nHits);
+
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<Timestamp_t> randomTS(0, 3600000000000000);
+  const uint64_t runSize = nRuns > 0 ? (nHits + nRuns - 1) / nRuns : 0;
+  for (uint64_t i = 0; i < nHits; i++) {
+    if (nRuns == 0) {
+      hits.Timestamp[i] = randomTS(rng);
+    } else {
+      // 1 hit per us in each run
+      hits.Timestamp[i] =
+          Timestamp_t(i % runSize) * 1000000 + Timestamp_t(i / runSize) * 137;
+    }
+    hits.Board[i] = i % 11;
+    hits.Channel[i] = i % 16;
+    hits.Energy[i] = i % 4096;
+    hits.EnergyShort[i] = i % 1024;
+  }
+
+  return hits;
+}
+
+// The sort before the integer timestamps: double keys, __gnu_parallel::sort
+static void CompareSort(THitStore &hits)
+{
+  std::vector<std::pair<Double_t, uint64_t>> keys(hits.size());
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    keys[i] = std::make_pair(TicksToNs(hits.Timestamp[i]), i);
+  }
+  __gnu_parallel::sort(keys.begin(), keys.end(),
+                       [](const std::pair<Double_t, uint64_t> &a,
+                          const std::pair<Double_t, uint64_t> &b) {
+                         return a.first < b.first;
+                       });
+
+  THitStore sorted;
+  sorted.resize(hits.size());
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    sorted.Timestamp[i] = hits.Timestamp[keys[i].second];
+    sorted.Board[i] = hits.Board[keys[i].second];
+    sorted.Channel[i] = hits.Channel[keys[i].second];
+    sorted.Energy[i] = hits.Energy[keys[i].second];
+    sorted.EnergyShort[i] = hits.EnergyShort[keys[i].second];
+  }
+  std::swap(hits, sorted);
+}
+
+template <class Func>
+static double Measure(Func func)
+{
+  const auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+int main(int argc, char *argv[])
+{
+  uint64_t nHits = 100000000;
+  uint32_t nRuns = 64;
+  if (argc > 1) nHits = std::stoull(argv[1]);
+  if (argc > 2) nRuns = std::stoul(argv[2]);
+  const uint32_t nThreads = std::thread::hardware_concurrency();
+
+  std::cout << nHits << " hits, " << nRuns << " runs" << std::endl;
+  // Many runs go to the radix sort, a few runs to the k-way merge
+  for (auto nSortRuns : {nRuns, std::min<uint32_t>(nRuns, 8)}) {
+    auto hits = MakeHits(nHits, nSortRuns);
+    auto copy = hits;
+
+    const auto compareTime = Measure([&]() { CompareSort(copy); });
+    const auto newTime = Measure([&]() { hits.SortByTime(nThreads); });
+    // Hits with the same timestamp can be in another order
+    const bool isSame = hits.Timestamp == copy.Timestamp;
+
+    std::cout << nSortRuns << " runs\tcomparison sort: " << compareTime
+              << " s\tSortByTime: " << newTime << " s\t"
+              << (isSame ? "same order" : "DIFFERENT ORDER") << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,82 @@
+#ifndef TBoundedQueue_HPP
+#define TBoundedQueue_HPP 1
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// Blocking FIFO with a capacity.  Push waits while the queue is full, and Pop
+// waits while it is empty.  The time spent waiting is summed for the stage
+// profile of the event builder.
+template <typename T>
+class TBoundedQueue
+{
+ public:
+  TBoundedQueue(std::size_t capacity) : fCapacity(capacity > 0 ? capacity : 1)
+  {};
+  ~TBoundedQueue() {};
+
+  void Push(T item)
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    const auto start = std::chrono::steady_clock::now();
+    fNotFull.wait(lock, [this] { return fQueue.size() < fCapacity; });
+    fPushWaitTime += Elapsed(start);
+    fQueue.push_back(std::move(item));
+    fNotEmpty.notify_one();
+  };
+
+  // false when the queue is closed and empty
+  bool Pop(T &item)
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    const auto start = std::chrono::steady_clock::now();
+    fNotEmpty.wait(lock, [this] { return !fQueue.empty() || fIsClosed; });
+    fPopWaitTime += Elapsed(start);
+    if (fQueue.empty()) return false;
+    item = std::move(fQueue.front());
+    fQueue.pop_front();
+    fNotFull.notify_one();
+    return true;
+  };
+
+  // No more Push.  Pop returns false after the remaining items.
+  void Close()
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fIsClosed = true;
+    fNotEmpty.notify_all();
+  };
+
+  double GetPushWaitTime()
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fPushWaitTime;
+  };
+  double GetPopWaitTime()
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fPopWaitTime;
+  };
+
+ private:
+  static double Elapsed(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+
+  std::size_t fCapacity;
+  std::deque<T> fQueue;
+  bool fIsClosed = false;
+  std::mutex fMutex;
+  std::condition_variable fNotFull;
+  std::condition_variable fNotEmpty;
+  double fPushWaitTime = 0.;
+  double fPopWaitTime = 0.;
+};
+
+#endif
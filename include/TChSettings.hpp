@@ -7,6 +7,15 @@
 #include <string>
 #include <vector>
 
+// Detector groups counted separately by the event builder
+enum DetectorCategory : uint8_t {
+  kNoCategory = 0,
+  kGamma,
+  kEJ,
+  kGS,
+  kNCategories
+};
+
 class TChSettings
 {
  public:
@@ -20,6 +29,7 @@ class TChSettings
   uint32_t ch = 0;
   double_t timeOffset = 0.;
   uint32_t thresholdADC = 0;
+  std::string category = "None";  // Gamma, EJ, GS or None
 
   bool hasAC = false;
   uint32_t ACMod = 0;
@@ -44,6 +54,7 @@ class TChSettings
     std::cout << "\tTime Offset: " << timeOffset << std::endl;
     std::cout << "\tIs Event Trigger: " << isEventTrigger << std::endl;
     std::cout << "\tDetector ID: " << detectorID << std::endl;
+    std::cout << "\tCategory: " << category << std::endl;
     std::cout << "\tHas AC: " << hasAC << std::endl;
     std::cout << "\tAC Module: " << ACMod << "\tAC Channel: " << ACCh
               << std::endl;
@@ -65,6 +76,7 @@ class TChSettings
         nlohmann::json ch;
         ch["IsEventTrigger"] = false;
         ch["DetectorID"] = 0;
+        ch["Category"] = "None";
         ch["Module"] = i;
         ch["Channel"] = j;
         ch["HasAC"] = false;
@@ -114,6 +126,7 @@ class TChSettings
         chSetting.isEventTrigger = ch["IsEventTrigger"];
         chSetting.coincidenceID = ch["CoincidenceID"];
         chSetting.detectorID = ch["DetectorID"];
+        chSetting.category = ch.value("Category", "None");
         chSetting.mod = ch["Module"];
         chSetting.ch = ch["Channel"];
         chSetting.timeOffset = ch["TimeOffset"];
@@ -139,6 +152,17 @@ class TChSettings
 
     return chSettingsVec;
   };
+
+  static DetectorCategory GetCategoryCode(const std::string &category)
+  {
+    if (category == "Gamma") return kGamma;
+    if (category == "EJ") return kEJ;
+    if (category == "GS") return kGS;
+    if (category != "None") {
+      std::cerr << "Unknown detector category: " << category << std::endl;
+    }
+    return kNoCategory;
+  };
 };
 
 typedef TChSettings ChSettings_t;
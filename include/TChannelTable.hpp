@@ -0,0 +1,102 @@
+#ifndef TChannelTable_hpp
+#define TChannelTable_hpp 1
+
+#include <TROOT.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "TChSettings.hpp"
+
+// What the event builder needs of one channel, in one cache line
+struct alignas(64) ChannelInfo_t {
+  Double_t p0 = 0.;
+  Double_t p1 = 1.;
+  Double_t p2 = 0.;
+  Double_t p3 = 0.;
+  Double_t timeOffset = 0.;
+  int32_t detectorID = 0;
+  int32_t acIndex = -1;  // Table index of the AC partner, -1: no AC
+  bool isEventTrigger = false;
+  uint8_t category = kNoCategory;
+
+  Double_t GetCalibratedEnergy(UShort_t adc) const
+  {
+    return p0 + p1 * adc + p2 * adc * adc + p3 * adc * adc * adc;
+  };
+};
+
+// Flat table of ChannelInfo_t indexed by board * nCh + ch.  Made once from
+// the channel settings.  No bounds check, the loader only accepts hits of
+// channels found in the settings.
+class TChannelTable
+{
+ public:
+  TChannelTable() {};
+  TChannelTable(const ChSettingsVec_t &chSettingsVec)
+  {
+    fNBoards = chSettingsVec.size();
+    for (const auto &mod : chSettingsVec) {
+      fNChs = std::max<uint32_t>(fNChs, mod.size());
+    }
+    fTable.resize(fNBoards * fNChs);
+
+    for (auto i = 0; i < chSettingsVec.size(); i++) {
+      for (auto j = 0; j < chSettingsVec[i].size(); j++) {
+        const auto &chSetting = chSettingsVec[i][j];
+        auto &info = fTable[GetIndex(i, j)];
+        info.p0 = chSetting.p0;
+        info.p1 = chSetting.p1;
+        info.p2 = chSetting.p2;
+        info.p3 = chSetting.p3;
+        info.timeOffset = chSetting.timeOffset;
+        info.detectorID = chSetting.detectorID;
+        info.isEventTrigger = chSetting.isEventTrigger;
+        info.category = TChSettings::GetCategoryCode(chSetting.category);
+        if (chSetting.hasAC && chSetting.ACMod < fNBoards &&
+            chSetting.ACCh < fNChs) {
+          info.acIndex = GetIndex(chSetting.ACMod, chSetting.ACCh);
+        }
+      }
+    }
+  };
+  ~TChannelTable() {};
+
+  uint32_t GetIndex(uint32_t brd, uint32_t ch) const
+  {
+    return brd * fNChs + ch;
+  };
+  const ChannelInfo_t &Get(uint32_t index) const { return fTable[index]; };
+  const ChannelInfo_t &Get(uint32_t brd, uint32_t ch) const
+  {
+    return fTable[GetIndex(brd, ch)];
+  };
+
+  uint32_t GetNBoards() const { return fNBoards; };
+  uint32_t GetNChs() const { return fNChs; };
+  uint32_t GetSize() const { return fTable.size(); };
+
+  bool HasCategory() const
+  {
+    for (const auto &info : fTable) {
+      if (info.category != kNoCategory) return true;
+    }
+    return false;
+  };
+
+  // Size for arrays indexed by detector ID
+  uint32_t GetNDetectorIDs() const
+  {
+    int32_t maxID = -1;
+    for (const auto &info : fTable) maxID = std::max(maxID, info.detectorID);
+    return maxID + 1;
+  };
+
+ private:
+  uint32_t fNBoards = 0;
+  uint32_t fNChs = 0;
+  std::vector<ChannelInfo_t> fTable;
+};
+
+#endif
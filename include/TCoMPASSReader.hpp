@@ -0,0 +1,65 @@
+#ifndef TCoMPASSReader_HPP
+#define TCoMPASSReader_HPP 1
+
+#include <TROOT.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "THitReader.hpp"
+
+struct stat;
+
+// Reader of CAEN CoMPASS binary list mode files (*.BIN), memory mapped and
+// decoded record by record straight into the THitStore.
+// CoMPASS 2 files start with a 16 bit header, 0xCAEx, whose bits tell the
+// optional fields.  A record is
+//   board (16), channel (16), timestamp in ps (64),
+//   [energy (16)], [calibrated energy (64)], [energy short (16)],
+//   flags (32), [waveform code (8), nSamples (32), samples (16 x nSamples)]
+// Files without the header are CoMPASS 1: board, channel, timestamp,
+// energy, energy short and flags, no waveform.
+class TCoMPASSReader : public THitReader
+{
+ public:
+  TCoMPASSReader(std::string fileName, const ChSettingsVec_t &chSettingsVec);
+  ~TCoMPASSReader();
+
+  bool IsOpen() const override { return fData != nullptr; };
+  std::string GetTreeName() const override { return "CoMPASS"; };
+  std::vector<EntryRange_t> GetClusters() const override;
+  void Read(Long64_t first, Long64_t last, THitStore &hits) override;
+
+ protected:
+  Double_t GetRawTS(Long64_t entry) override;
+
+ private:
+  int fFD = -1;
+  const char *fData = nullptr;
+  std::size_t fSize = 0;
+
+  std::size_t fHeaderSize = 0;
+  bool fHasEnergy = true;
+  bool fHasCalibratedEnergy = false;
+  bool fHasEnergyShort = true;
+  bool fHasWaveform = false;
+  std::size_t fEnergyShortPos = 14;  // In a record
+
+  // Fixed record size, or the start of each record with waveforms.  The
+  // record starts are shared by all readers of the same file in this
+  // process, so a file is scanned once per run, not once per open.
+  std::size_t fRecordSize = 20;
+  std::shared_ptr<const std::vector<std::size_t>> fRecordPos;
+  std::size_t GetRecordPos(Long64_t entry) const
+  {
+    return fHasWaveform ? (*fRecordPos)[entry]
+                        : fHeaderSize + entry * fRecordSize;
+  };
+  void IndexRecords(const struct stat &st);
+
+  static constexpr Long64_t kClusterSize = 1 << 20;  // Records
+};
+
+#endif
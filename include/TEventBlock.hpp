@@ -0,0 +1,75 @@
+#ifndef TEventBlock_HPP
+#define TEventBlock_HPP 1
+
+#include <TROOT.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "THitStore.hpp"
+
+// Events built from one chunk of hits, handed from a builder thread to its
+// writer.  The hits of all events are flat in Hits (Timestamp is the time
+// from the trigger, in ps), and event i is Hits[FirstHit[i], FirstHit[i + 1]).
+// Without the hit copy (hit reference layout), only HitIndex and NHits tell
+// the hits of event i, as entries of the hit table.
+class TEventBlock
+{
+ public:
+  // hitOffset: hit table entry of the first hit of the hit store
+  TEventBlock(bool isHitCopied = true, Long64_t hitOffset = 0)
+      : fIsHitCopied(isHitCopied), fHitOffset(hitOffset)
+  {
+    FirstHit.push_back(0);
+  };
+  ~TEventBlock() {};
+
+  THitStore Hits;
+  std::vector<uint64_t> FirstHit;
+  std::vector<Long64_t> HitIndex;
+  std::vector<UInt_t> NHits;
+  std::vector<Long64_t> TriggerIndex;
+  std::vector<UChar_t> TriggerID;
+  std::vector<Timestamp_t> TriggerTS;
+  std::vector<UChar_t> Multiplicity;
+  std::vector<UChar_t> GammaMultiplicity;
+  std::vector<UChar_t> EJMultiplicity;
+  std::vector<UChar_t> GSMultiplicity;
+  std::vector<UChar_t> IsFissionTrigger;
+
+  std::size_t GetNEvents() const { return TriggerID.size(); };
+
+  // Hits [begin, end) of hitStore, with the time relative to triggerTS.
+  // triggerHit is the index of the trigger in hitStore.
+  void AddEvent(const THitStore &hitStore, std::size_t begin, std::size_t end,
+                std::size_t triggerHit, UChar_t triggerID,
+                Timestamp_t triggerTS, UChar_t multiplicity,
+                UChar_t gammaMultiplicity, UChar_t ejMultiplicity,
+                UChar_t gsMultiplicity, bool isFissionTrigger)
+  {
+    if (fIsHitCopied) {
+      for (auto k = begin; k < end; k++) {
+        Hits.emplace_back(hitStore.Board[k], hitStore.Channel[k],
+                          hitStore.Timestamp[k] - triggerTS,
+                          hitStore.Energy[k], hitStore.EnergyShort[k]);
+      }
+    }
+    FirstHit.push_back(Hits.size());
+    HitIndex.push_back(fHitOffset + begin);
+    NHits.push_back(end - begin);
+    TriggerIndex.push_back(fHitOffset + triggerHit);
+    TriggerID.push_back(triggerID);
+    TriggerTS.push_back(triggerTS);
+    Multiplicity.push_back(multiplicity);
+    GammaMultiplicity.push_back(gammaMultiplicity);
+    EJMultiplicity.push_back(ejMultiplicity);
+    GSMultiplicity.push_back(gsMultiplicity);
+    IsFissionTrigger.push_back(isFissionTrigger);
+  };
+
+ private:
+  bool fIsHitCopied;
+  Long64_t fHitOffset;
+};
+
+#endif
@@ -7,15 +7,27 @@
 
 #include <deque>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#include "TBoundedQueue.hpp"
 #include "TChSettings.hpp"
+#include "TChannelTable.hpp"
+#include "TEventBlock.hpp"
+#include "TEventPolicy.hpp"
+#include "TEventWriter.hpp"
+#include "TExternalSort.hpp"
+#include "THitCache.hpp"
 #include "THitData.hpp"
 #include "THitLoader.hpp"
+#include "THitStore.hpp"
+#include "THitTableWriter.hpp"
+#include "TTriggerWindow.hpp"
+#include "TWorkStealingQueue.hpp"
 
 class TEventBuilder
 {
@@ -25,23 +37,105 @@ class TEventBuilder
                 std::vector<std::string> fileList, HitFileType hitType);
   ~TEventBuilder() {};
 
+  // Three stages run at the same time:
+  //   load: a loader thread reads and sorts the next batch
+  //   build: nThreads threads search events in the current batch
+  //   write: one writer thread per output file fills and compresses
   void BuildEvent(uint32_t nFiles = 10, uint32_t nThreads = 16);
 
- private:
-  Double_t GetCalibratedEnergy(const ChSettings_t &chSetting,
-                               const UShort_t &adc);
+  // 0: load and sort nFiles files at once (default)
+  // >0: streaming mode, merge nFiles files and build every nHits hits
+  void SetStreamingMode(uint64_t nHits) { fStreamChunkSize = nHits; };
+
+  // Out-of-core mode for runs larger than the memory.  The batches of
+  // nFiles files are sorted and spilled to scratchDir, and the events are
+  // built from the merged runs.  The merge keeps to memoryBudget bytes.
+  void SetExternalSort(std::string scratchDir, uint64_t memoryBudget)
+  {
+    fScratchDir = scratchDir;
+    fMemoryBudget = memoryBudget;
+  };
+
+  // Keep the sorted hits in cacheDir, and load them from there when the
+  // same files are built again with the same time offsets
+  void SetCacheDir(std::string cacheDir) { fCacheDir = cacheDir; };
+
+  // Build only the triggers in [from, to) (ns, time offset applied).  Hits
+  // are loaded one time window more at each side.
+  void SetTimeRange(Double_t from, Double_t to)
+  {
+    fTimeFrom = from;
+    fTimeTo = to;
+  };
+
+  // Flat (default), Object or HitRef, see TEventSchema.hpp.  HitRef also
+  // writes the hit table to hits.root.
+  void SetOutputLayout(EventLayout layout) { fLayout = layout; };
+
+  // One time ordered events.root instead of event_t<thread>.root.  The
+  // blocks of all builder threads go to one writer in trigger time order.
+  void SetSingleOutput(bool isSingle) { fIsSingleOutput = isSingle; };
 
+  // Compression, basket size and auto flush of the output files
+  void SetWriteSettings(WriteSettings_t settings)
+  {
+    fWriteSettings = settings;
+  };
+
+ private:
   Double_t fTimeWindow = 1000;  // in ns
-  void SearchAndWriteELIGANTEvents(uint32_t nThreads = 16,
-                                   bool firstRun = false);
-  void SearchAndWriteFissionEvents(uint32_t nThreads = 16,
-                                   bool firstRun = false);
+  Timestamp_t fHalfWindow = 500000;  // in ps
+  // One event search engine, specialized by a policy of TEventPolicy.hpp
+  template <class Policy>
+  void SearchEvents(uint32_t nThreads = 16);
 
   std::vector<std::string> fFileList;
   ChSettingsVec_t fChSettingsVec;
-  std::vector<bool> fIsTriggerDetector;
-  std::unique_ptr<std::vector<HitData_t>> fHitVec;
+  TChannelTable fChannelTable;
+  std::unique_ptr<THitStore> fHitVec;
+
+  // Load stage.  Pushes sorted batches to the queue and closes it at the
+  // end.  The queue holds one batch, the next one while this one is built.
+  void LoadHits(uint32_t nFiles, uint32_t nThreads,
+                TBoundedQueue<std::unique_ptr<THitStore>> &queue);
+  static constexpr uint32_t kLoadQueueSize = 1;
+
+  // Write stage.  Builder thread i hands its events to fWriters[i], or all
+  // threads to fWriters[0] in the single output mode.
+  std::vector<std::unique_ptr<TEventWriter>> fWriters;
+  static constexpr uint32_t kWriteQueueSize = 4;
+  EventLayout fLayout = EventLayout::Flat;
+  bool fIsSingleOutput = false;
+  WriteSettings_t fWriteSettings;
+  // Sequence number of the first chunk of this loop, for PushOrdered
+  uint64_t fChunkSequence = 0;
+  // HitRef only.  fHitOffset is the hit table entry of fHitVec->at(0).
+  std::unique_ptr<THitTableWriter> fHitTableWriter;
+  Long64_t fHitOffset = 0;
+
+  // Busy and waiting time of each stage, summed over threads
+  std::mutex fProfileMutex;
+  double fLoadTime = 0.;
+  double fLoadWaitTime = 0.;
+  double fSearchTime = 0.;
+  double fSearchWaitTime = 0.;
+  uint64_t fNEvents = 0;
+  void AddProfile(double searchTime, double waitTime, uint64_t nEvents);
+  void PrintProfile();
+
+  // Triggers in [fTriggerBegin, fTriggerEnd) of fHitVec are built.  The
+  // others are only the neighbours carried over from or to the next loop.
+  uint64_t fTriggerBegin = 0;
+  uint64_t fTriggerEnd = 0;
+  static constexpr uint64_t kChunksPerThread = 16;
+  static constexpr uint64_t kMinChunkSize = 10000;
   HitFileType fHitType = HitFileType::DELILA;
+  uint64_t fStreamChunkSize = 0;
+  std::string fScratchDir;
+  uint64_t fMemoryBudget = 0;  // 0: no external sort
+  std::string fCacheDir;  // Empty: no hit cache
+  Double_t fTimeFrom = std::numeric_limits<Double_t>::lowest();
+  Double_t fTimeTo = std::numeric_limits<Double_t>::max();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,69 @@
+#ifndef TEventPolicy_HPP
+#define TEventPolicy_HPP 1
+
+#include <cstdint>
+
+#include "TChannelTable.hpp"
+#include "TTriggerWindow.hpp"
+
+// Policies of TEventBuilder::SearchEvents.  Everything is static and inlined
+// into the window loop.  A new setup needs only a new policy:
+//   Classify: category histogram bin of a hit of the trigger's window
+//   IsAccepted: acceptance test of a window that passed the trigger veto
+//   IsFissionTrigger: the fission flag of the event
+//   IsToBeFilled: output selection
+
+// Default behaviour, shared by the setups below
+class TDefaultEventPolicy
+{
+ public:
+  // The "Category" of the channel in the channel settings
+  static uint8_t Classify(const ChannelInfo_t &hit,
+                          const ChannelInfo_t &trigger)
+  {
+    return hit.category;
+  };
+
+  static bool IsAccepted(const TTriggerWindow &window)
+  {
+    return window.Size() > 1;
+  };
+
+  static bool IsFissionTrigger(uint32_t multiplicity, double eneSum,
+                               uint32_t gammaMultiplicity)
+  {
+    return multiplicity > 2 && eneSum > 1000 && gammaMultiplicity > 0;
+  };
+
+  static bool IsToBeFilled(bool isFissionTrigger) { return true; };
+};
+
+// DELILA fission setup.  At least one hit other than the trigger.  All
+// hits of the window count in the category of the trigger, by its
+// detector ID, as the fission builder always did.  The categories of the
+// channel settings are not used.
+class TFissionPolicy : public TDefaultEventPolicy
+{
+ public:
+  static uint8_t Classify(const ChannelInfo_t &hit,
+                          const ChannelInfo_t &trigger)
+  {
+    const auto id = trigger.detectorID;
+    if (31 < id && id < 66) return kGamma;
+    if (79 < id && id < 117) return kEJ;
+    if (118 < id && id < 144) return kGS;
+    return kNoCategory;
+  };
+};
+
+// ELIGANT setup.  Both the front (board 0) and the back (board 1) fired.
+class TELIGANTPolicy : public TDefaultEventPolicy
+{
+ public:
+  static bool IsAccepted(const TTriggerWindow &window)
+  {
+    return window.HasBoard(0) && window.HasBoard(1);
+  };
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef TEventReader_HPP
+#define TEventReader_HPP 1
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TEventSchema.hpp"
+#include "THitData.hpp"
+#include "THitRefEventReader.hpp"
+
+// Reads the event files of every layout of TEventSchema.hpp, and gives the
+// hits of each event as the THitData vector of the old Event branch.
+// Macros written for std::vector<THitData> only change the loop:
+//   TEventReader reader("event_t0.root");
+//   for (auto i = 0; i < reader.GetEntries(); i++) {
+//     reader.GetEntry(i);
+//     for (auto &hit : reader.GetEvent()) ...
+//   }
+// For the Flat layout, reading the columns of GetTree() directly is faster.
+class TEventReader
+{
+ public:
+  TEventReader(std::string fileName, std::string hitFileName = "hits.root");
+  ~TEventReader();
+
+  bool IsOpen() const;
+  EventLayout GetLayout() const { return fLayout; };
+  Int_t GetSchemaVersion() const { return fSchemaVersion; };
+  TTree *GetTree() const { return fTree; };
+
+  Long64_t GetEntries() const;
+  void GetEntry(Long64_t i);
+  const std::vector<THitData> &GetEvent() const { return *fEvent; };
+
+  // Values of the current event
+  UChar_t TriggerID = 0;
+  Double_t TriggerTS = 0.;
+  UChar_t Multiplicity = 0;
+  UChar_t GammaMultiplicity = 0;
+  UChar_t EJMultiplicity = 0;
+  UChar_t GSMultiplicity = 0;
+  Bool_t IsFissionTrigger = false;
+
+ private:
+  // Grows the flat hit columns to nHits and sets the new branch addresses
+  void ResizeFlatColumns(std::size_t nHits);
+  static constexpr std::size_t kFlatColumnSize = 256;
+  void OpenNTuple(std::string fileName);
+  void GetNTupleEntry(Long64_t i);
+
+  EventLayout fLayout = EventLayout::Flat;
+  Int_t fSchemaVersion = 0;
+  TFile *fFile = nullptr;
+  TTree *fTree = nullptr;
+  std::unique_ptr<THitRefEventReader> fHitRefReader;
+  std::vector<THitData> *fEvent = nullptr;
+
+  UInt_t fNHits = 0;
+  std::vector<UChar_t> fBoard;
+  std::vector<UChar_t> fChannel;
+  std::vector<Double_t> fDT;
+  std::vector<UShort_t> fEnergy;
+  std::vector<UShort_t> fEnergyShort;
+
+  // RNTuple layout, defined in the source only.  The class has the same
+  // layout with and without USE_RNTUPLE, also in interpreted macros.
+  struct NTupleState;
+  std::unique_ptr<NTupleState> fNTuple;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef TEventSchema_HPP
+#define TEventSchema_HPP 1
+
+#include <Rtypes.h>
+
+// Layouts of the event files
+//   Flat: Event_Tree with one event per entry and the hits in flat
+//     columns nHits, Board[nHits], Channel[nHits], dT[nHits] (ns from the
+//     trigger), Energy[nHits] and EnergyShort[nHits].  Schema version 2.
+//   Object: Event_Tree with the hits in the Event branch, a vector of
+//     THitData.  Schema version 1, the files before the version was kept.
+//   HitRef: Event_Table, each event refers to its hits in the hit table
+//     (THitTableWriter) by the first entry and the number of hits.  The
+//     table can hold a hit twice, see THitTableWriter.
+//   RNTuple: Event_Tree as RNTuple (USE_RNTUPLE builds only), with the
+//     hits in the vector fields Board, Channel, dT, Energy and EnergyShort
+enum class EventLayout { Flat, Object, HitRef, RNTuple };
+
+// The schema version is kept in the user info of Event_Tree, as
+// TParameter<Int_t> named kEventSchemaKey.  No version means 1.
+constexpr Int_t kEventSchemaVersion = 2;
+constexpr const char *kEventSchemaKey = "EventSchemaVersion";
+
+#endif
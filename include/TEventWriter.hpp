@@ -0,0 +1,91 @@
+#ifndef TEventWriter_HPP
+#define TEventWriter_HPP 1
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TBoundedQueue.hpp"
+#include "TEventBlock.hpp"
+#include "TEventSchema.hpp"
+#include "THitData.hpp"
+#include "TWriteSettings.hpp"
+
+// Output stage.  Owns one output file and a thread that converts the event
+// blocks of the builder to the layout of TEventSchema.hpp and fills (and
+// compresses) the tree.
+class TEventWriter
+{
+ public:
+  TEventWriter(std::string fileName, uint32_t queueSize = 4,
+               EventLayout layout = EventLayout::Flat,
+               WriteSettings_t settings = WriteSettings_t());
+  ~TEventWriter();
+
+  // Blocks while the queue is full
+  void Push(std::unique_ptr<TEventBlock> block);
+
+  // From several threads, for one ordered file.  The blocks are written in
+  // the order of sequence (0, 1, 2, ... without gaps), whatever order they
+  // come in.  Early blocks are kept until the missing ones come.
+  void PushOrdered(uint64_t sequence, std::unique_ptr<TEventBlock> block);
+
+  // Write the rest and close the file
+  void Close();
+
+  double GetBusyTime() const { return fBusyTime; };
+  double GetWaitTime() { return fQueue.GetPopWaitTime(); };
+  double GetPushWaitTime() { return fQueue.GetPushWaitTime(); };
+
+ private:
+  void WriteLoop();
+  void OpenTree();
+  void OpenNTuple();
+  void FillNTuple(const TEventBlock &block, std::size_t i);
+  // Grows the flat hit columns to nHits and sets the new branch addresses
+  void ResizeFlatColumns(std::size_t nHits);
+  static constexpr std::size_t kFlatColumnSize = 256;
+
+  std::string fFileName;
+  EventLayout fLayout;
+  WriteSettings_t fSettings;
+  TBoundedQueue<std::unique_ptr<TEventBlock>> fQueue;
+  std::mutex fOrderMutex;
+  std::map<uint64_t, std::unique_ptr<TEventBlock>> fPendingBlocks;
+  uint64_t fNextSequence = 0;
+  std::thread fThread;
+  bool fIsClosed = false;
+  double fBusyTime = 0.;
+
+  TFile *fFile = nullptr;
+  TTree *fTree = nullptr;
+  std::vector<THitData> *fEvent = nullptr;
+  std::vector<UChar_t> fBoard;
+  std::vector<UChar_t> fChannel;
+  std::vector<Double_t> fDT;
+  std::vector<UShort_t> fEnergy;
+  std::vector<UShort_t> fEnergyShort;
+  Long64_t fFirstHit = 0;
+  UInt_t fNHits = 0;
+  Long64_t fTriggerIndex = 0;
+  UChar_t fTriggerID = 0;
+  Double_t fTriggerTS = 0.;
+  UChar_t fMultiplicity = 0;
+  UChar_t fGammaMultiplicity = 0;
+  UChar_t fEJMultiplicity = 0;
+  UChar_t fGSMultiplicity = 0;
+  Bool_t fIsFissionTrigger = false;
+
+  // RNTuple layout, defined in the source only.  The class has the same
+  // layout with and without USE_RNTUPLE.
+  struct NTupleState;
+  std::unique_ptr<NTupleState> fNTuple;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef TExternalSort_HPP
+#define TExternalSort_HPP 1
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "THitStore.hpp"
+
+// Out-of-core sort of a run larger than the memory.  Each sorted batch is
+// spilled to a run file in the scratch directory, and the runs are merged
+// by a k-way heap into time ordered chunks.  The sorted batches, the read
+// buffers of the runs and the output chunks are sized from the memory
+// budget.
+class TExternalSort
+{
+ public:
+  // nChunks output chunks are in memory at the same time (being merged,
+  // queued and searched)
+  TExternalSort(std::string scratchDir, uint64_t memoryBudget,
+                uint32_t nChunks = 3);
+  ~TExternalSort();  // The run files are removed
+
+  // Write sorted hits as one run
+  bool AddRun(const THitStore &hits);
+  uint32_t GetNRuns() const { return fRuns.size(); };
+
+  // Start merging the runs.  LoadNextHits returns up to nHits time ordered
+  // hits, and an empty store at the end.
+  void StartMerge();
+  std::unique_ptr<THitStore> LoadNextHits(uint64_t nHits);
+  // Hits per output chunk within the budget
+  uint64_t GetChunkSize() const;
+  // Hits sorted at once within the budget
+  uint64_t GetBatchSize() const;
+
+  // Timestamp, Board, Channel, Energy, EnergyShort
+  static constexpr uint64_t kHitSize = 14;
+  // Bytes per hit in a THitStore, with the slack of the vectors growing
+  // when the carry is merged in
+  static constexpr uint64_t kStoreHitMemory = 24;
+  // Bytes per hit while a batch is sorted: the store, the sort keys and
+  // their merge buffer (16 B each), and a gather temporary
+  static constexpr uint64_t kSortHitMemory = 48;
+
+ private:
+  std::string fScratchDir;
+  uint64_t fMemoryBudget;
+  uint32_t fNChunks;
+
+  struct Run_t {
+    std::string fileName;
+    uint64_t nHits = 0;
+    uint64_t nRead = 0;
+    std::ifstream file;
+    THitStore buffer;
+    std::size_t pos = 0;
+  };
+  std::vector<std::unique_ptr<Run_t>> fRuns;
+  std::vector<uint32_t> fHeap;
+  uint64_t fBufferSize = 0;  // Hits read at once from each run
+  std::vector<char> fBytes;
+
+  bool FillBuffer(Run_t &run);
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef THitCache_HPP
+#define THitCache_HPP 1
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TChSettings.hpp"
+#include "THitReader.hpp"
+#include "THitStore.hpp"
+
+// Sorted, offset corrected hits of a file list, saved by the first run and
+// memory mapped by the later runs, which then skip reading and sorting.
+// The cache file name is a hash of the input files (name, size and mtime),
+// the DAQ type, the time offsets and the loaded time range (-from/-to
+// widened by the time window).  A file is a list of blocks, one per loaded
+// batch, each with the columns one after another.
+class THitCache
+{
+ public:
+  THitCache(std::string cacheDir, const std::vector<std::string> &fileList,
+            HitFileType fileType, const ChSettingsVec_t &chSettingsVec,
+            Double_t timeFrom, Double_t timeTo);
+  ~THitCache();
+
+  const std::string &GetFileName() const { return fFileName; };
+
+  // Map an existing cache.  LoadNextHits returns the next block, and an
+  // empty store at the end.
+  bool Open();
+  std::unique_ptr<THitStore> LoadNextHits();
+
+  // Write a new cache.  It is renamed to the final name by Commit, so an
+  // aborted run leaves no broken cache.
+  bool Create();
+  bool Write(const THitStore &hits);
+  bool Commit();
+
+ private:
+  std::string fFileName;
+  std::string fTmpFileName;
+
+  int fFD = -1;
+  char *fData = nullptr;
+  std::size_t fSize = 0;
+  std::size_t fPos = 0;
+
+  std::ofstream fOut;
+  bool fIsWriteOK = false;
+
+  static constexpr char kMagic[8] = {'H', 'I', 'T', 'C', 'A', 'C', 'H', '1'};
+  static std::size_t GetBlockSize(uint64_t nHits);
+};
+
+#endif
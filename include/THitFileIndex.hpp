@@ -0,0 +1,64 @@
+#ifndef THitFileIndex_HPP
+#define THitFileIndex_HPP 1
+
+#include <TROOT.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TChSettings.hpp"
+#include "THitReader.hpp"
+#include "THitStore.hpp"
+
+// Summary of one input file, kept next to it as <file>.idx.json.  It is
+// made when the file is read for the first time, and is valid while the
+// size and the modification time of the file are the same.  With it, the
+// loader plans the reading without opening the file.
+class THitFileIndex
+{
+ public:
+  THitFileIndex(std::string fileName, HitFileType fileType);
+  ~THitFileIndex() {};
+
+  // Read the sidecar.  False if there is none, or if it is out of date.
+  bool Load();
+  bool Save() const;
+  static std::string GetIndexName(const std::string &fileName);
+
+  // Set from the reader, and from all hits of the file (time offset applied)
+  void SetTree(const THitReader &reader);
+  void SetHits(const std::vector<const THitStore *> &hitsVec,
+               const ChSettingsVec_t &chSettingsVec);
+
+  const std::string &GetTreeName() const { return fTreeName; };
+  Long64_t GetEntries() const { return fNEntries; };
+  uint64_t GetNHits() const { return fNHits; };
+  const std::vector<EntryRange_t> &GetClusters() const { return fClusters; };
+
+  // Per board, without the time offset of the channels
+  struct BoardIndex_t {
+    uint32_t board = 0;
+    Timestamp_t minTS = 0;  // ps
+    Timestamp_t maxTS = 0;
+    std::vector<uint64_t> nHits;  // Per channel
+  };
+  const std::vector<BoardIndex_t> &GetBoards() const { return fBoards; };
+
+ private:
+  std::string fFileName;
+  HitFileType fFileType;
+  uint64_t fFileSize = 0;
+  int64_t fFileTime = 0;
+  bool ReadFileStatus(uint64_t &size, int64_t &time) const;
+
+  std::string fTreeName;
+  Long64_t fNEntries = 0;
+  uint64_t fNHits = 0;
+  std::vector<EntryRange_t> fClusters;
+  std::vector<BoardIndex_t> fBoards;
+
+  static constexpr uint32_t kVersion = 2;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef THitFileReader_HPP
+#define THitFileReader_HPP 1
+
+#include <TBranch.h>
+#include <TBufferFile.h>
+#include <TFile.h>
+#include <TTree.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TChSettings.hpp"
+#include "THitReader.hpp"
+#include "THitStore.hpp"
+
+// Reader of the ROOT hit trees, DELILA (ELIADE_Tree) and ELIGANT (tout).
+// The branches are read basket by basket as arrays (ROOT bulk API), and the
+// flag cut and time offset run as passes over the arrays.  Falls back to
+// GetEntry per entry when a branch does not support bulk reading.
+class THitFileReader : public THitReader
+{
+ public:
+  THitFileReader(std::string fileName, HitFileType fileType,
+                 const ChSettingsVec_t &chSettingsVec);
+  ~THitFileReader();
+
+  bool IsOpen() const override { return fTree != nullptr; };
+  std::string GetTreeName() const override
+  {
+    return fTree ? fTree->GetName() : "";
+  };
+
+  // Entry clusters of the tree.  A cluster is decompressed as one unit, so
+  // different threads can read different clusters without overlap.
+  std::vector<EntryRange_t> GetClusters() const override;
+
+  void Read(Long64_t first, Long64_t last, THitStore &hits) override;
+
+ protected:
+  Double_t GetRawTS(Long64_t entry) override;
+
+ private:
+  void SetDELILABranches();
+  void SetELIGANTBranches();
+  void SetBulkRead();
+
+  void ReadEntries(Long64_t first, Long64_t last, THitStore &hits);
+  bool ReadDELILABulk(Long64_t first, Long64_t last, THitStore &hits);
+  bool ReadELIGANTBulk(Long64_t first, Long64_t last, THitStore &hits);
+  // Copy entries [first, last) of branch into column
+  template <typename T>
+  bool ReadColumn(TBranch *branch, Long64_t first, Long64_t last,
+                  std::vector<T> &column);
+  // Time offset and append of n hits in the column buffers
+  template <typename ID_t, typename TS_t>
+  void AppendColumns(const std::vector<ID_t> &brd,
+                     const std::vector<ID_t> &ch,
+                     const std::vector<TS_t> &ts, std::size_t n,
+                     THitStore &hits);
+
+  HitFileType fFileType = HitFileType::DELILA;
+
+  TFile *fFile = nullptr;
+  TTree *fTree = nullptr;
+
+  bool fUseBulkRead = false;
+  TBufferFile fBulkBuffer{TBuffer::kWrite, 10000};
+  TBranch *fBrdBranch = nullptr;
+  TBranch *fChBranch = nullptr;
+  TBranch *fEneBranch = nullptr;
+  TBranch *fEneShortBranch = nullptr;
+  TBranch *fTSBranch = nullptr;
+  TBranch *fFlagBranch = nullptr;
+
+  // Column buffers, reused between reads
+  std::vector<UChar_t> fDELILABrdCol;
+  std::vector<UChar_t> fDELILAChCol;
+  std::vector<Double_t> fDELILATSCol;
+  std::vector<UShort_t> fELIGANTBrdCol;
+  std::vector<UShort_t> fELIGANTChCol;
+  std::vector<ULong64_t> fELIGANTTSCol;
+  std::vector<UInt_t> fELIGANTFlagCol;
+  std::vector<UShort_t> fEneCol;
+  std::vector<UShort_t> fEneShortCol;
+  std::vector<uint32_t> fIndexCol;
+
+  // Branch buffers
+  UChar_t fDELILABrd = 0;
+  UChar_t fDELILACh = 0;
+  Double_t fDELILATS = 0.;
+  UShort_t fELIGANTBrd = 0;
+  UShort_t fELIGANTCh = 0;
+  ULong64_t fELIGANTTS = 0;
+  UInt_t fELIGANTFlag = 0;
+  UShort_t fEne = 0;
+  UShort_t fEneShort = 0;
+};
+
+#endif
@@ -2,37 +2,94 @@
 #define THitLoader_HPP 1
 
 #include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "TChSettings.hpp"
 #include "THitData.hpp"
-
-enum class HitFileType { DELILA, ELIGANT };
+#include "THitFileIndex.hpp"
+#include "THitReader.hpp"
+#include "THitStore.hpp"
+#include "THitStream.hpp"
 
 class THitLoader
 {
  public:
-  THitLoader(){};
-  THitLoader(ChSettingsVec_t chSettingsVec) : fChSettingsVec(chSettingsVec){};
+  THitLoader() { SetTimeOffsetRange(); };
+  THitLoader(ChSettingsVec_t chSettingsVec) : fChSettingsVec(chSettingsVec)
+  {
+    SetTimeOffsetRange();
+  };
   ~THitLoader(){};
 
-  std::unique_ptr<std::vector<HitData_t>> LoadHitsMT(
+  std::unique_ptr<THitStore> LoadHitsMT(
       std::vector<std::string> fileList, uint32_t nThreads,
       HitFileType fileType = HitFileType::DELILA);
+  // Hits of each file, from its index.  A file without an index is opened,
+  // and its entries are counted.
+  std::vector<uint64_t> CountHits(const std::vector<std::string> &fileList,
+                                  uint32_t nThreads,
+                                  HitFileType fileType = HitFileType::DELILA);
+
+  // Streaming mode.  At most nOpenFiles files are opened at the same time and
+  // merged by a k-way heap.  LoadNextHits returns up to nHits time ordered
+  // hits, and an empty store at the end of the file list.
+  void OpenStream(std::vector<std::string> fileList,
+                  HitFileType fileType = HitFileType::DELILA,
+                  uint32_t nOpenFiles = 16, uint32_t chunkSize = 100000);
+  std::unique_ptr<THitStore> LoadNextHits(uint64_t nHits,
+                                          uint32_t nThreads = 1);
+
+  // Only hits in [from, to] (ns, time offset applied) are needed.  Files out
+  // of the range are skipped by their index, and of the files at the edges
+  // only the entry clusters in the range are read.  A file without an index
+  // is read completely once, to make its index.
+  void SetTimeRange(Double_t from, Double_t to);
+  // Files of fileList that can have hits in the range
+  std::vector<std::string> SelectFiles(
+      const std::vector<std::string> &fileList,
+      HitFileType fileType = HitFileType::DELILA);
 
  private:
   ChSettingsVec_t fChSettingsVec;
 
-  std::unique_ptr<std::vector<HitData_t>> fHitVec;
-  std::vector<bool> fInsertFlags;
-  std::mutex fHitVecMutex;
+  std::unique_ptr<THitStore> fHitVec;
   std::mutex fFileListMutex;
-  void LoadDELILAHits(std::string fileName, uint32_t threadID);
-  void LoadELIGANTHits(std::string fileName, uint32_t threadID);
+
+  // Entries [first, last) of the file fileIndex, read by one thread
+  struct LoadTask_t {
+    uint32_t fileIndex;
+    Long64_t first;
+    Long64_t last;
+  };
+  static constexpr uint32_t kTasksPerThread = 4;
+  void RunThreads(std::function<void()> func, uint32_t nThreads);
+
+  Double_t fTimeFrom = std::numeric_limits<Double_t>::lowest();
+  Double_t fTimeTo = std::numeric_limits<Double_t>::max();
+  bool fHasTimeRange = false;
+  // Smallest and largest time offset of each board
+  std::vector<Double_t> fMinTimeOffset;
+  std::vector<Double_t> fMaxTimeOffset;
+  void SetTimeOffsetRange();
+  // [first, last] time of the file, time offset applied
+  std::pair<Double_t, Double_t> GetTimeRange(
+      const THitFileIndex &index) const;
+  bool IsInTimeRange(const THitFileIndex &index) const;
+
+  std::vector<std::unique_ptr<THitStream>> fStreams;
+  std::vector<uint32_t> fStreamHeap;
+  std::vector<std::string> fStreamFileList;
+  HitFileType fStreamFileType = HitFileType::DELILA;
+  uint32_t fStreamChunkSize = 100000;
+  Timestamp_t fLastStreamTS = 0;
+  uint64_t fNLateHits = 0;
+  bool OpenNextStream(uint32_t slot);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef THitReader_HPP
+#define THitReader_HPP 1
+
+#include <TROOT.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TChSettings.hpp"
+#include "THitStore.hpp"
+
+enum class HitFileType { DELILA, ELIGANT, COMPASS };
+
+// Entries [first, second)
+typedef std::pair<Long64_t, Long64_t> EntryRange_t;
+
+// Interface of the input file readers.  The loader, the stream and the
+// index only use this class, so a new DAQ format is one new reader and one
+// line in Open.  A reader unpacks entry ranges into a THitStore, with the
+// time offset of each channel applied.  One reader is used by one thread.
+class THitReader
+{
+ public:
+  THitReader(std::string fileName, const ChSettingsVec_t &chSettingsVec);
+  virtual ~THitReader() {};
+
+  // Reader for the file type.  Check IsOpen() of the result.
+  static std::unique_ptr<THitReader> Open(std::string fileName,
+                                          HitFileType fileType,
+                                          const ChSettingsVec_t &chSettingsVec);
+
+  virtual bool IsOpen() const = 0;
+  Long64_t GetEntries() const { return fNEntries; };
+  // Hit tree name, or the format name of a non ROOT file
+  virtual std::string GetTreeName() const = 0;
+
+  // Entry ranges that are read as one unit (ROOT clusters, or blocks of
+  // records).  Different threads can read different clusters.
+  virtual std::vector<EntryRange_t> GetClusters() const = 0;
+
+  // Append the hits of entries [first, last) to hits.  Not sorted.
+  virtual void Read(Long64_t first, Long64_t last, THitStore &hits) = 0;
+
+  // Entries of the clusters that can hold raw timestamps (ns, without time
+  // offset) in [from, to], by binary search on the first entry of each
+  // cluster.  The file must be close to time ordered.  One more cluster at
+  // each edge takes up the disorder inside a cluster.
+  EntryRange_t FindEntryRange(Double_t from, Double_t to,
+                              const std::vector<EntryRange_t> &clusters);
+
+ protected:
+  // Raw timestamp of the entry, in ns
+  virtual Double_t GetRawTS(Long64_t entry) = 0;
+
+  std::string fFileName;
+  const ChSettingsVec_t &fChSettingsVec;
+  Long64_t fNEntries = 0;
+
+  // Flat time offset table (ps) indexed by brd * fNChs + ch
+  uint32_t fNBoards = 0;
+  uint32_t fNChs = 0;
+  std::vector<Timestamp_t> fTimeOffset;
+  std::vector<bool> fIsKnownCh;
+  bool IsKnownCh(uint32_t brd, uint32_t ch) const
+  {
+    return brd < fNBoards && ch < fNChs && fIsKnownCh[brd * fNChs + ch];
+  };
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef THitRefEventReader_HPP
+#define THitRefEventReader_HPP 1
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <string>
+#include <vector>
+
+#include "THitData.hpp"
+
+// Reads the hit reference layout (-o hitref): Event_Table of an event file
+// and Hit_Table of the hit file.  GetEntry(i) makes the same THitData
+// vector as the Event branch of Event_Tree, with Timestamp relative to
+// the trigger, from the hit table.
+//   THitRefEventReader reader("event_t0.root", "hits.root");
+//   for (auto i = 0; i < reader.GetEntries(); i++) {
+//     reader.GetEntry(i);
+//     for (auto &hit : reader.GetEvent()) ...
+//   }
+class THitRefEventReader
+{
+ public:
+  THitRefEventReader(std::string eventFileName,
+                     std::string hitFileName = "hits.root");
+  ~THitRefEventReader();
+
+  bool IsOpen() const { return fEventTree && fHitTree; };
+  Long64_t GetEntries() const;
+  void GetEntry(Long64_t i);
+  const std::vector<THitData> &GetEvent() const { return fEvent; };
+
+  // Values of the current event
+  UChar_t TriggerID = 0;
+  Double_t TriggerTS = 0.;
+  UChar_t Multiplicity = 0;
+  UChar_t GammaMultiplicity = 0;
+  UChar_t EJMultiplicity = 0;
+  UChar_t GSMultiplicity = 0;
+  Bool_t IsFissionTrigger = false;
+  Long64_t FirstHit = 0;
+  UInt_t NHits = 0;
+  Long64_t TriggerIndex = 0;
+
+ private:
+  TFile *fEventFile = nullptr;
+  TFile *fHitFile = nullptr;
+  TTree *fEventTree = nullptr;
+  TTree *fHitTree = nullptr;
+  std::vector<THitData> fEvent;
+
+  UChar_t fBoard = 0;
+  UChar_t fChannel = 0;
+  Double_t fTimestamp = 0.;
+  UShort_t fEnergy = 0;
+  UShort_t fEnergyShort = 0;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef THitStore_HPP
+#define THitStore_HPP 1
+
+#include <TROOT.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "THitData.hpp"
+#include "TTimestamp.hpp"
+
+// Column wise hit container.  The event search scans only Timestamp, and the
+// other columns are touched only for the hits in the window.
+class THitStore
+{
+ public:
+  THitStore() {};
+  ~THitStore() {};
+
+  std::vector<Timestamp_t> Timestamp;  // ps
+  std::vector<UChar_t> Board;
+  std::vector<UChar_t> Channel;
+  std::vector<UShort_t> Energy;
+  std::vector<UShort_t> EnergyShort;
+
+  std::size_t size() const { return Timestamp.size(); };
+  bool empty() const { return Timestamp.empty(); };
+  void reserve(std::size_t n);
+  void resize(std::size_t n);
+  void clear();
+  void emplace_back(UChar_t brd, UChar_t ch, Timestamp_t ts, UShort_t ene,
+                    UShort_t eneShort)
+  {
+    Timestamp.push_back(ts);
+    Board.push_back(brd);
+    Channel.push_back(ch);
+    Energy.push_back(ene);
+    EnergyShort.push_back(eneShort);
+  };
+
+  // Append hits [first, last) of other
+  void Append(const THitStore &other, std::size_t first, std::size_t last);
+  void Append(const THitStore &other) { Append(other, 0, other.size()); };
+  // Overwrite [offset, offset + other.size()) with other.  Different threads
+  // can copy into disjoint ranges of a presized store.
+  void CopyAt(std::size_t offset, const THitStore &other);
+  void PushBack(const THitStore &other, std::size_t i)
+  {
+    emplace_back(other.Board[i], other.Channel[i], other.Timestamp[i],
+                 other.Energy[i], other.EnergyShort[i]);
+  };
+
+  THitData GetHit(std::size_t i) const
+  {
+    return THitData(Board[i], Channel[i], TicksToNs(Timestamp[i]), Energy[i],
+                    EnergyShort[i]);
+  };
+
+  // Index of the first hit with Timestamp >= ts.  The store must be sorted.
+  std::size_t LowerBound(Timestamp_t ts) const;
+
+  // Sort (timestamp, index) pairs, and then gather each column once.  Up
+  // to kMaxMergeRuns time ordered runs are merged by one k-way merge, more
+  // are sorted by a parallel LSD radix sort on the integer timestamp.  Both
+  // use at most nThreads threads.
+  void SortByTime(uint32_t nThreads = 1);
+  bool IsSorted() const;
+  static constexpr std::size_t kMaxMergeRuns = 16;
+
+  // Merge the sorted carry into the head of this sorted store.  Only the
+  // overlapping hits are merged, the rest is moved column wise.
+  void MergeFront(const THitStore &carry);
+};
+
+#endif
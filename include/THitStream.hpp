@@ -0,0 +1,38 @@
+#ifndef THitStream_HPP
+#define THitStream_HPP 1
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "TChSettings.hpp"
+#include "THitReader.hpp"
+#include "THitStore.hpp"
+
+// One input file read in chunks of entries.  Each chunk is sorted by time,
+// so the front of the stream is time ordered as long as the file is close to
+// time ordered (true for the digitizer output).
+class THitStream
+{
+ public:
+  THitStream(std::string fileName, HitFileType fileType,
+             const ChSettingsVec_t &chSettingsVec, uint32_t chunkSize);
+  ~THitStream() {};
+
+  bool IsEmpty() const { return fPos >= fChunk.size(); };
+  Timestamp_t FrontTS() const { return fChunk.Timestamp[fPos]; };
+  void CopyFront(THitStore &dest) const { dest.PushBack(fChunk, fPos); };
+  void Pop();
+
+ private:
+  bool FillChunk();
+
+  std::unique_ptr<THitReader> fReader;
+  uint32_t fChunkSize = 100000;
+  Long64_t fNextEntry = 0;
+
+  THitStore fChunk;
+  std::size_t fPos = 0;
+};
+
+#endif
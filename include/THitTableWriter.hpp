@@ -0,0 +1,48 @@
+#ifndef THitTableWriter_HPP
+#define THitTableWriter_HPP 1
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <string>
+
+#include "THitStore.hpp"
+#include "TWriteSettings.hpp"
+
+// Hit table of the hit reference layout (Hit_Table).  Each loop of the
+// builder appends its time sorted hit store without the hits carried over
+// from the previous loop, which are already the last entries.  When a
+// batch starts before the carried hits end, the whole store is appended,
+// so the table can hold a hit twice and is not time ordered across such
+// a loop.  The events of Event_Table refer to their hits by entry number,
+// always one contiguous range.
+class THitTableWriter
+{
+ public:
+  THitTableWriter(std::string fileName,
+                  WriteSettings_t settings = WriteSettings_t());
+  ~THitTableWriter();
+
+  // Append hits [first, size).  Can run while the builder threads read the
+  // store.
+  void Write(const THitStore &hits, std::size_t first = 0);
+  void Close();
+
+  Long64_t GetEntries() const { return fNEntries; };
+  double GetBusyTime() const { return fBusyTime; };
+
+ private:
+  std::string fFileName;
+  TFile *fFile = nullptr;
+  TTree *fTree = nullptr;
+  Long64_t fNEntries = 0;
+  double fBusyTime = 0.;
+
+  UChar_t fBoard = 0;
+  UChar_t fChannel = 0;
+  Double_t fTimestamp = 0.;  // ns
+  UShort_t fEnergy = 0;
+  UShort_t fEnergyShort = 0;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef TTimestamp_HPP
+#define TTimestamp_HPP 1
+
+#include <TROOT.h>
+
+#include <cmath>
+#include <limits>
+
+// Hit time inside the builder, in ps ticks.  Compares and sorts are integer,
+// and the resolution does not depend on the run time.  It is converted to
+// double ns only for the output (THitData::Timestamp, TriggerTS).
+typedef Long64_t Timestamp_t;
+
+constexpr Timestamp_t kTicksPerNs = 1000;
+constexpr Timestamp_t kMinTimestamp = std::numeric_limits<Timestamp_t>::min();
+constexpr Timestamp_t kMaxTimestamp = std::numeric_limits<Timestamp_t>::max();
+
+// Saturates at kMinTimestamp and kMaxTimestamp, e.g. for an open time range
+inline Timestamp_t NsToTicks(Double_t ns)
+{
+  const auto ticks = ns * kTicksPerNs;
+  if (ticks <= Double_t(kMinTimestamp)) return kMinTimestamp;
+  if (ticks >= Double_t(kMaxTimestamp)) return kMaxTimestamp;
+  return std::llround(ticks);
+}
+
+inline Double_t TicksToNs(Timestamp_t ticks)
+{
+  return Double_t(ticks) / kTicksPerNs;
+}
+
+#endif
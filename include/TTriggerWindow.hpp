@@ -0,0 +1,55 @@
+#ifndef TTriggerWindow_HPP
+#define TTriggerWindow_HPP 1
+
+#include <cstdint>
+#include <vector>
+
+#include "TChannelTable.hpp"
+#include "THitStore.hpp"
+
+// Sliding window [Begin(), End()) of the hits within +-timeWindow/2 of a
+// trigger.  The lower and upper edges only move forward, and the number of
+// trigger detector hits in the window is kept per detector ID.  Moving the
+// window over all triggers visits every hit a constant number of times.
+class TTriggerWindow
+{
+ public:
+  TTriggerWindow(const THitStore &hits, const TChannelTable &channelTable,
+                 Double_t timeWindow);
+  ~TTriggerWindow() {};
+
+  // Move the window to the trigger hit j.  j must not decrease.
+  void MoveTo(std::size_t j);
+
+  std::size_t Begin() const { return fBegin; };
+  std::size_t End() const { return fEnd; };
+  std::size_t Size() const { return fEnd - fBegin; };
+  bool HasBoard(UChar_t brd) const
+  {
+    return brd < fBoardCount.size() && fBoardCount[brd] > 0;
+  };
+
+  // A trigger detector hit with a smaller detector ID is in the window, or
+  // the same detector fired before the current trigger.
+  bool IsRejected(int32_t triggerID) const;
+
+ private:
+  int32_t GetTriggerDetectorID(std::size_t k) const;
+  void Add(std::size_t k);
+  void Remove(std::size_t k);
+
+  const THitStore &fHits;
+  const TChannelTable &fChannelTable;
+  Timestamp_t fHalfWindow;  // ps
+
+  bool fIsInit = false;
+  std::size_t fBegin = 0;
+  std::size_t fEnd = 0;
+  std::size_t fNext = 0;  // lastTriggerHit is updated up to here
+
+  std::vector<uint32_t> fTriggerCount;
+  std::vector<int64_t> fLastTriggerHit;
+  std::vector<uint32_t> fBoardCount;
+};
+
+#endif
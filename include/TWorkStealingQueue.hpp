@@ -0,0 +1,33 @@
+#ifndef TWorkStealingQueue_HPP
+#define TWorkStealingQueue_HPP 1
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Chunks 0 ... nChunks - 1 are dealt to the threads as contiguous blocks.
+// A thread takes its own chunks from the front, and when it runs out, it
+// steals from the back of the thread with the most chunks left.  The owner
+// keeps working on neighbouring chunks, so the data stays in its cache.
+class TWorkStealingQueue
+{
+ public:
+  TWorkStealingQueue(uint64_t nChunks, uint32_t nThreads);
+  ~TWorkStealingQueue() {};
+
+  // false when no chunk is left anywhere
+  bool Pop(uint32_t threadID, uint64_t &chunk);
+
+ private:
+  struct ChunkRange {
+    std::mutex mutex;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+  };
+  std::vector<std::unique_ptr<ChunkRange>> fRanges;
+
+  bool Steal(uint64_t &chunk);
+};
+
+#endif
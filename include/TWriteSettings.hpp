@@ -0,0 +1,34 @@
+#ifndef TWriteSettings_HPP
+#define TWriteSettings_HPP 1
+
+#include <Compression.h>
+#include <TFile.h>
+#include <TTree.h>
+
+// Compression and buffering of the output files.  The unset values keep
+// the ROOT defaults.
+struct WriteSettings_t {
+  // ROOT::CompressionSettings(algorithm, level), e.g. 505 for ZSTD 5
+  Int_t compression = -1;
+  // Basket size of every branch in bytes
+  Int_t basketSize = 0;
+  // TTree::SetAutoFlush: >0 entries, <0 compressed bytes per cluster
+  Long64_t autoFlush = 0;
+};
+
+// Compression before the tree is made, the branches take it from the file
+inline void ApplyWriteSettings(TFile *file, const WriteSettings_t &settings)
+{
+  if (settings.compression >= 0) {
+    file->SetCompressionSettings(settings.compression);
+  }
+}
+
+// After all branches are made
+inline void ApplyWriteSettings(TTree *tree, const WriteSettings_t &settings)
+{
+  if (settings.basketSize > 0) tree->SetBasketSize("*", settings.basketSize);
+  if (settings.autoFlush != 0) tree->SetAutoFlush(settings.autoFlush);
+}
+
+#endif
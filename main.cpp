@@ -1,3 +1,4 @@
+#include <Compression.h>
 #include <TChain.h>
 #include <TFile.h>
 #include <TROOT.h>
@@ -8,6 +9,8 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <nlohmann/json.hpp>
 #include <parallel/algorithm>
 #include <string>
@@ -23,14 +26,34 @@ int main(int argc, char *argv[])
   uint32_t nFiles = 0;
   uint32_t nFilesLoop = 0;
   uint32_t nThreads = 16;
+  uint64_t nStreamHits = 0;
+  uint64_t memoryBudget = 0;  // in MB
+  std::string scratchDir = ".";
+  std::string cacheDir;
   Double_t timeWindow = 2000;  // in ns
+  Double_t timeFrom = std::numeric_limits<Double_t>::lowest();
+  Double_t timeTo = std::numeric_limits<Double_t>::max();
   HitFileType hitFileType = HitFileType::DELILA;
+  EventLayout eventLayout = EventLayout::Flat;
+  bool isSingleOutput = false;
+  WriteSettings_t writeSettings;
+  std::string compressionName;
+  Int_t compressionLevel = -1;
   auto fileListName = std::string(argv[argc - 1]);
   // -f is number of files to be processed
   // -l is number of files to be processed in one loop
   // -t is number of threads
   // -w is time window in ns
   // -d is daq type
+  // -s is number of hits in one loop of streaming mode
+  // -from and -to are the time range of the triggers in ns
+  // -m is memory budget of the external sort in MB
+  // -scratch is directory for the spilled runs of the external sort
+  // -cache is directory of the sorted hit cache
+  // -o is output layout
+  // -single is one time ordered output file
+  // -z and -zl are compression algorithm and level of the output
+  // -basket is basket size in bytes, -flush is auto flush of the output
   // -h is help
   for (int i = 1; i < argc; i++) {
     if (std::string(argv[i]) == "-l") {
@@ -45,11 +68,65 @@ int main(int argc, char *argv[])
     if (std::string(argv[i]) == "-w") {
       timeWindow = std::stod(argv[i + 1]);
     }
+    if (std::string(argv[i]) == "-s") {
+      nStreamHits = std::stoull(argv[i + 1]);
+    }
+    if (std::string(argv[i]) == "-m") {
+      memoryBudget = std::stoull(argv[i + 1]);
+    }
+    if (std::string(argv[i]) == "-scratch") {
+      scratchDir = argv[i + 1];
+    }
+    if (std::string(argv[i]) == "-cache") {
+      cacheDir = argv[i + 1];
+    }
+    if (std::string(argv[i]) == "-from") {
+      timeFrom = std::stod(argv[i + 1]);
+    }
+    if (std::string(argv[i]) == "-to") {
+      timeTo = std::stod(argv[i + 1]);
+    }
+    if (std::string(argv[i]) == "-o") {
+      if (std::string(argv[i + 1]) == "flat") {
+        eventLayout = EventLayout::Flat;
+      } else if (std::string(argv[i + 1]) == "object") {
+        eventLayout = EventLayout::Object;
+      } else if (std::string(argv[i + 1]) == "hitref") {
+        eventLayout = EventLayout::HitRef;
+      } else if (std::string(argv[i + 1]) == "rntuple") {
+#ifdef USE_RNTUPLE
+        eventLayout = EventLayout::RNTuple;
+#else
+        std::cerr << "This build has no RNTuple support" << std::endl;
+        return 1;
+#endif
+      } else {
+        std::cerr << "Unknown output layout: " << argv[i + 1] << std::endl;
+        return 1;
+      }
+    }
+    if (std::string(argv[i]) == "-z") {
+      compressionName = argv[i + 1];
+    }
+    if (std::string(argv[i]) == "-zl") {
+      compressionLevel = std::stoi(argv[i + 1]);
+    }
+    if (std::string(argv[i]) == "-basket") {
+      writeSettings.basketSize = std::stoi(argv[i + 1]);
+    }
+    if (std::string(argv[i]) == "-flush") {
+      writeSettings.autoFlush = std::stoll(argv[i + 1]);
+    }
+    if (std::string(argv[i]) == "-single") {
+      isSingleOutput = true;
+    }
     if (std::string(argv[i]) == "-d") {
       if (std::string(argv[i + 1]) == "ELIGANT") {
         hitFileType = HitFileType::ELIGANT;
       } else if (std::string(argv[i + 1]) == "DELILA") {
         hitFileType = HitFileType::DELILA;
+      } else if (std::string(argv[i + 1]) == "COMPASS") {
+        hitFileType = HitFileType::COMPASS;
       } else {
         std::cerr << "Unknown DAQ type: " << argv[i + 1] << std::endl;
         return 1;
@@ -68,7 +145,44 @@ int main(int argc, char *argv[])
                 << std::endl;
       std::cout << "  -w <time window in ns> : Set time window in ns"
                 << std::endl;
-      std::cout << "  -d <daq type> : Set DAQ type (ELIGANT or DELILA)"
+      std::cout << "  -d <daq type> : Set DAQ type (ELIGANT, DELILA or "
+                   "COMPASS for CoMPASS binary files)"
+                << std::endl;
+      std::cout << "  -s <number of hits> : Streaming mode.  Merge -l files "
+                   "on the fly and build events every <number of hits>"
+                << std::endl;
+      std::cout << "  -from <time in ns> -to <time in ns> : Build only the "
+                   "triggers in the time range.  Files out of the range are "
+                   "not read."
+                << std::endl;
+      std::cout << "  -m <memory in MB> : External sort.  Spill the sorted "
+                   "batches of -l files and merge them within the memory"
+                << std::endl;
+      std::cout << "  -scratch <directory> : Directory for the spilled hits "
+                   "(default: current directory)"
+                << std::endl;
+      std::cout << "  -cache <directory> : Save the sorted hits there, and "
+                   "reuse them when the same files and time offsets are "
+                   "built again"
+                << std::endl;
+      std::cout << "  -o <layout> : Output layout.  flat: hits in flat "
+                   "columns (default).  object: hits in a THitData vector "
+                   "(old files).  hitref: events refer to the hit table in "
+                   "hits.root.  rntuple: flat columns as RNTuple"
+                << std::endl;
+      std::cout << "  -single : Write one time ordered events.root instead "
+                   "of one file per thread"
+                << std::endl;
+      std::cout << "  -z <algorithm> : Compression of the output (ZSTD, LZ4, "
+                   "ZLIB or LZMA, default: ROOT default)"
+                << std::endl;
+      std::cout << "  -zl <level> : Compression level (default: the "
+                   "default of the algorithm)"
+                << std::endl;
+      std::cout << "  -basket <bytes> : Basket size of the output branches"
+                << std::endl;
+      std::cout << "  -flush <n> : Auto flush of the output.  >0: entries, "
+                   "<0: compressed bytes"
                 << std::endl;
       std::cout << "  -h : Show this help" << std::endl;
       std::cout << "To generate a file list, please use \"ls -v1 "
@@ -93,6 +207,30 @@ int main(int argc, char *argv[])
     fileList.resize(nFiles);
   }
 
+  // Algorithm and its default level
+  using Algorithm_t = ROOT::RCompressionSetting::EAlgorithm;
+  using Level_t = ROOT::RCompressionSetting::ELevel;
+  const std::map<std::string, std::pair<Algorithm_t::EValues, Int_t>>
+      compressionMap = {
+          {"ZSTD", {Algorithm_t::kZSTD, Level_t::kDefaultZSTD}},
+          {"LZ4", {Algorithm_t::kLZ4, Level_t::kDefaultLZ4}},
+          {"ZLIB", {Algorithm_t::kZLIB, Level_t::kDefaultZLIB}},
+          {"LZMA", {Algorithm_t::kLZMA, Level_t::kDefaultLZMA}}};
+  if (compressionName != "") {
+    auto it = compressionMap.find(compressionName);
+    if (it == compressionMap.end()) {
+      std::cerr << "Unknown compression: " << compressionName << std::endl;
+      return 1;
+    }
+    if (compressionLevel < 0) compressionLevel = it->second.second;
+    writeSettings.compression =
+        ROOT::CompressionSettings(it->second.first, compressionLevel);
+  } else if (compressionLevel >= 0) {
+    // Level of the default algorithm
+    writeSettings.compression =
+        ROOT::CompressionSettings(Algorithm_t::kUseGlobal, compressionLevel);
+  }
+
   if (nFilesLoop == 0) {
     nFilesLoop = nThreads;
   }
@@ -106,6 +244,15 @@ int main(int argc, char *argv[])
 
   auto builder =
       TEventBuilder(timeWindow, chSettingsVec, fileList, hitFileType);
+  builder.SetStreamingMode(nStreamHits);
+  builder.SetTimeRange(timeFrom, timeTo);
+  builder.SetCacheDir(cacheDir);
+  builder.SetOutputLayout(eventLayout);
+  builder.SetSingleOutput(isSingleOutput);
+  builder.SetWriteSettings(writeSettings);
+  if (memoryBudget > 0) {
+    builder.SetExternalSort(scratchDir, memoryBudget * 1024 * 1024);
+  }
   builder.BuildEvent(nFilesLoop, nThreads);
 
   return 0;
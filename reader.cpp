@@ -7,6 +7,7 @@
 #include <TSystem.h>
 #include <TTree.h>
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <iostream>
@@ -17,18 +18,51 @@
 #include <vector>
 
 #include "TChSettings.hpp"
+#include "TEventReader.hpp"
 #include "THitData.hpp"
 
 std::vector<std::string> GetFileList(const std::string dirName)
 {
   std::vector<std::string> fileList;
 
-  auto searchKey = Form("event_t");
-  // auto searchKey = Form("event_run%d_s", runNo);
+  // event_t<N>.root of each thread, or events.root of -single.  If both are
+  // there, the ones of the later run.
+  std::string singleFile;
+  auto threadTime = std::filesystem::file_time_type::min();
+  auto singleTime = std::filesystem::file_time_type::min();
   for (const auto &entry : std::filesystem::directory_iterator(dirName)) {
-    if (entry.path().string().find(searchKey) != std::string::npos) {
-      fileList.push_back(entry.path().string());
+    const auto name = entry.path().filename().string();
+    const auto time = entry.last_write_time();
+    if (name == "events.root") {
+      singleFile = entry.path().string();
+      singleTime = time;
+      continue;
     }
+
+    const std::string prefix = "event_t";
+    const std::string suffix = ".root";
+    if (name.size() <= prefix.size() + suffix.size() ||
+        name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) !=
+            0) {
+      continue;
+    }
+    const auto number = name.substr(
+        prefix.size(), name.size() - prefix.size() - suffix.size());
+    if (number.find_first_not_of("0123456789") != std::string::npos) {
+      continue;
+    }
+    fileList.push_back(entry.path().string());
+    threadTime = std::max(threadTime, time);
+  }
+
+  if (!singleFile.empty() && (fileList.empty() || singleTime > threadTime)) {
+    if (!fileList.empty()) {
+      std::cout << "Older event_t*.root files are skipped" << std::endl;
+    }
+    fileList = {singleFile};
+  } else if (!singleFile.empty()) {
+    std::cout << "Older " << singleFile << " is skipped" << std::endl;
   }
 
   return fileList;
@@ -65,25 +99,13 @@ void AnalysisThread(TString fileName, uint32_t threadNo)
 {
   ROOT::EnableThreadSafety();
 
-  auto file = new TFile(fileName);
-  auto tree = (TTree *)file->Get("Event_Tree");
-  std::vector<THitData> *event = nullptr;
-  tree->SetBranchAddress("Event", &event);
-
-  UChar_t triggerID = 0;
-  tree->SetBranchAddress("TriggerID", &triggerID);
-  UChar_t multiplicity = 0;
-  tree->SetBranchAddress("Multiplicity", &multiplicity);
-  UChar_t gammaMultiplicity = 0;
-  tree->SetBranchAddress("GammaMultiplicity", &gammaMultiplicity);
-  UChar_t ejMultiplicity = 0;
-  tree->SetBranchAddress("EJMultiplicity", &ejMultiplicity);
-  UChar_t gsMultiplicity = 0;
-  tree->SetBranchAddress("GSMultiplicity", &gsMultiplicity);
-  Bool_t isFissionTrigger = false;
-  tree->SetBranchAddress("IsFissionTrigger", &isFissionTrigger);
-
-  auto nEntries = tree->GetEntries();
+  // Any layout of the event files (flat, object or hitref)
+  TEventReader reader(fileName.Data());
+  const auto &event = reader.GetEvent();
+  const auto &triggerID = reader.TriggerID;
+  const auto &isFissionTrigger = reader.IsFissionTrigger;
+
+  auto nEntries = reader.GetEntries();
   // nEntries /= 10;  // for test
   const auto startTime = std::chrono::system_clock::now();
   for (auto i = 0; i < nEntries; i++) {
@@ -98,11 +120,11 @@ void AnalysisThread(TString fileName, uint32_t threadNo)
                 << std::flush;
     }
 
-    tree->GetEntry(i);
+    reader.GetEntry(i);
 
     // if (isFissionTrigger) {
     if (true) {
-      for (auto &hit : *event) {
+      for (auto &hit : event) {
         auto id = hit.Board * 16 + hit.Channel;
         if (hit.Timestamp != 0.) {
           if (triggerID < 34) histTime[triggerID]->Fill(hit.Timestamp, id);
@@ -123,8 +145,6 @@ void AnalysisThread(TString fileName, uint32_t threadNo)
     }
   }
 
-  delete file;
-
   auto endTime = std::chrono::system_clock::now();
   auto elapsed =
       std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime)
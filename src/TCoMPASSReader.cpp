@@ -0,0 +1,159 @@
+#include "TCoMPASSReader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+template <typename T>
+static inline T Get(const char *p)
+{
+  T value;
+  std::memcpy(&value, p, sizeof(T));
+  return value;
+}
+
+TCoMPASSReader::TCoMPASSReader(std::string fileName,
+                               const ChSettingsVec_t &chSettingsVec)
+    : THitReader(fileName, chSettingsVec)
+{
+  fFD = open(fileName.c_str(), O_RDONLY);
+  if (fFD < 0) {
+    std::cerr << "File not found: " << fileName << std::endl;
+    return;
+  }
+  struct stat st;
+  if (fstat(fFD, &st) != 0 || st.st_size < 2) {
+    std::cerr << "Empty CoMPASS file: " << fileName << std::endl;
+    return;
+  }
+  fSize = st.st_size;
+  auto data = mmap(nullptr, fSize, PROT_READ, MAP_PRIVATE, fFD, 0);
+  if (data == MAP_FAILED) {
+    std::cerr << "Failed to map " << fileName << std::endl;
+    return;
+  }
+  fData = static_cast<const char *>(data);
+  madvise(data, fSize, MADV_SEQUENTIAL);
+
+  const auto header = Get<uint16_t>(fData);
+  if ((header & 0xFFF0) == 0xCAE0) {
+    fHeaderSize = 2;
+    fHasEnergy = header & 0x1;
+    fHasCalibratedEnergy = header & 0x2;
+    fHasEnergyShort = header & 0x4;
+    fHasWaveform = header & 0x8;
+  }
+  fEnergyShortPos =
+      12 + (fHasEnergy ? 2 : 0) + (fHasCalibratedEnergy ? 8 : 0);
+  fRecordSize = fEnergyShortPos + (fHasEnergyShort ? 2 : 0) + 4;  // + flags
+
+  if (fHasWaveform) {
+    IndexRecords(st);
+  } else {
+    fNEntries = (fSize - fHeaderSize) / fRecordSize;
+    if ((fSize - fHeaderSize) % fRecordSize != 0) {
+      std::cerr << "Last record of " << fileName << " is cut" << std::endl;
+    }
+  }
+}
+
+TCoMPASSReader::~TCoMPASSReader()
+{
+  if (fData) munmap(const_cast<char *>(fData), fSize);
+  if (fFD >= 0) close(fFD);
+}
+
+// Record starts of the files with waveforms, by name, size and mtime
+struct RecordIndex_t {
+  std::once_flag once;
+  std::shared_ptr<std::vector<std::size_t>> pos;
+};
+static std::mutex gRecordIndexMutex;
+static std::map<std::string, std::shared_ptr<RecordIndex_t>> gRecordIndexMap;
+
+void TCoMPASSReader::IndexRecords(const struct stat &st)
+{
+  const auto key = fFileName + " " + std::to_string(st.st_size) + " " +
+                   std::to_string(st.st_mtim.tv_sec) + "." +
+                   std::to_string(st.st_mtim.tv_nsec);
+  std::shared_ptr<RecordIndex_t> index;
+  {
+    std::lock_guard<std::mutex> lock(gRecordIndexMutex);
+    auto &entry = gRecordIndexMap[key];
+    if (!entry) entry = std::make_shared<RecordIndex_t>();
+    index = entry;
+  }
+
+  // The first reader scans, readers of the same file wait for it, and the
+  // other files are scanned in parallel
+  std::call_once(index->once, [this, &index]() {
+    // Records with waveforms have different sizes
+    auto pos = std::make_shared<std::vector<std::size_t>>();
+    std::size_t p = fHeaderSize;
+    while (p + fRecordSize + 5 <= fSize) {
+      const auto nSamples = Get<uint32_t>(fData + p + fRecordSize + 1);
+      const auto size = fRecordSize + 5 + std::size_t(nSamples) * 2;
+      if (p + size > fSize) break;
+      pos->push_back(p);
+      p += size;
+    }
+    if (p != fSize) {
+      std::cerr << "Last record of " << fFileName << " is cut" << std::endl;
+    }
+    index->pos = pos;
+  });
+  fRecordPos = index->pos;
+  fNEntries = fRecordPos->size();
+}
+
+std::vector<EntryRange_t> TCoMPASSReader::GetClusters() const
+{
+  std::vector<EntryRange_t> clusters;
+  for (Long64_t first = 0; first < fNEntries; first += kClusterSize) {
+    clusters.emplace_back(first, std::min(first + kClusterSize, fNEntries));
+  }
+
+  return clusters;
+}
+
+Double_t TCoMPASSReader::GetRawTS(Long64_t entry)
+{
+  return Double_t(Get<uint64_t>(fData + GetRecordPos(entry) + 4)) / 1000.;
+}
+
+void TCoMPASSReader::Read(Long64_t first, Long64_t last, THitStore &hits)
+{
+  if (!fData) return;
+  last = std::min(last, fNEntries);
+  if (first >= last) return;
+
+  const auto offset = hits.size();
+  hits.resize(offset + (last - first));
+  for (auto i = first; i < last; i++) {
+    const auto p = fData + GetRecordPos(i);
+    const auto brd = Get<uint16_t>(p);
+    const auto ch = Get<uint16_t>(p + 2);
+    if (!IsKnownCh(brd, ch)) {
+      hits.resize(offset);
+      throw std::out_of_range("Hit of a channel not in the settings: " +
+                              fFileName);
+    }
+
+    const auto k = offset + (i - first);
+    hits.Board[k] = brd;
+    hits.Channel[k] = ch;
+    hits.Timestamp[k] =
+        Timestamp_t(Get<uint64_t>(p + 4)) + fTimeOffset[brd * fNChs + ch];
+    hits.Energy[k] = fHasEnergy ? Get<uint16_t>(p + 12) : 0;
+    hits.EnergyShort[k] =
+        fHasEnergyShort ? Get<uint16_t>(p + fEnergyShortPos) : 0;
+  }
+}
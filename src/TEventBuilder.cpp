@@ -3,6 +3,10 @@
 #include <TROOT.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
 #include <parallel/algorithm>
 
 TEventBuilder::TEventBuilder(Double_t timeWindow, ChSettingsVec_t chSettingsVec,
@@ -10,422 +14,396 @@ TEventBuilder::TEventBuilder(Double_t timeWindow, ChSettingsVec_t chSettingsVec,
                              HitFileType hitType)
 {
   fTimeWindow = timeWindow;
+  fHalfWindow = NsToTicks(fTimeWindow / 2);
   fChSettingsVec = chSettingsVec;
+  fChannelTable = TChannelTable(fChSettingsVec);
   fFileList = fileList;
   fHitType = hitType;
-
-  for (auto i = 0; i < fChSettingsVec.size(); i++) {
-    for (auto j = 0; j < fChSettingsVec.at(i).size(); j++) {
-      if (fChSettingsVec.at(i).at(j).isEventTrigger) {
-        fIsTriggerDetector.push_back(true);
-      } else {
-        fIsTriggerDetector.push_back(false);
-      }
-    }
-  }
-}
-
-void TEventBuilder::BuildEvent(uint32_t nFiles, uint32_t nThreads)
-{
-  auto hitLoader = THitLoader(fChSettingsVec);
-
-  bool firstRun = true;
-  while (true) {
-    if (fFileList.size() == 0) {
-      break;
-    }
-
-    std::vector<std::string> fileList;
-    for (auto i = 0; i < nFiles; i++) {
-      if (fFileList.size() == 0) {
-        break;
-      }
-      fileList.push_back(fFileList.front());
-      fFileList.erase(fFileList.begin());
-    }
-    fHitVec = hitLoader.LoadHitsMT(fileList, nThreads, fHitType);
-    std::cout << fHitVec->size() << " hits loaded" << std::endl;
-
-    if (fHitVec->size() == 0) {
-      continue;
-    } else {
-    }
-
-    if (fHitType == HitFileType::ELIGANT) {
-      SearchAndWriteELIGANTEvents(nThreads, firstRun);
-    } else if (fHitType == HitFileType::DELILA) {
-      SearchAndWriteFissionEvents(nThreads, firstRun);
-    }
-
-    fHitVec.reset();
-    firstRun = false;
+  // Only the ELIGANT policy classifies the hits by their category
+  if (fHitType == HitFileType::ELIGANT && !fChannelTable.HasCategory()) {
+    std::cerr << "No detector has \"Category\" in the channel settings.  "
+                 "Gamma, EJ and GS multiplicities are always 0."
+              << std::endl;
   }
 }
 
-Double_t TEventBuilder::GetCalibratedEnergy(const ChSettings_t &chSetting,
-                                            const UShort_t &adc)
+template <class Policy>
+void TEventBuilder::SearchEvents(uint32_t nThreads)
 {
-  return chSetting.p0 + chSetting.p1 * adc + chSetting.p2 * adc * adc +
-         chSetting.p3 * adc * adc * adc;
-}
-
-void TEventBuilder::SearchAndWriteELIGANTEvents(uint32_t nThreads,
-                                                bool firstRun)
-{
-  // ROOT::EnableThreadSafety();
+  // Contiguous chunks of hits, several per thread for load balancing
+  const uint64_t nTriggerHits = fTriggerEnd - fTriggerBegin;
+  const uint64_t nChunks =
+      std::max<uint64_t>(1, std::min<uint64_t>(nThreads * kChunksPerThread,
+                                               nTriggerHits / kMinChunkSize));
+  const uint64_t chunkSize = (nTriggerHits + nChunks - 1) / nChunks;
+  TWorkStealingQueue queue(nChunks, nThreads);
 
   std::vector<std::thread> threads;
   for (auto i = 0; i < nThreads; i++) {
-    threads.emplace_back([this, i, nThreads, firstRun]() {
-      auto fileName = Form("event_t%d.root", i);
-      auto treeName = Form("Event_Tree");
-      TFile *file = nullptr;
-      TTree *tree = nullptr;
-      std::vector<THitData> *event = new std::vector<THitData>();
-      UChar_t triggerID;
-      Double_t triggerTS;
-      UChar_t multiplicity;
-      UChar_t gammaMultiplicity;
-      UChar_t ejMultiplicity;
-      UChar_t gsMultiplicity;
-      Bool_t isFissionTrigger;
-      if (firstRun) {
-        file = TFile::Open(fileName, "RECREATE");
-        tree = new TTree(treeName, "Event Tree");
-        tree->Branch("Event", &event);
-        tree->Branch("TriggerID", &triggerID);
-        tree->Branch("TriggerTS", &triggerTS);
-        tree->Branch("Multiplicity", &multiplicity);
-        tree->Branch("GammaMultiplicity", &gammaMultiplicity);
-        tree->Branch("EJMultiplicity", &ejMultiplicity);
-        tree->Branch("GSMultiplicity", &gsMultiplicity);
-        tree->Branch("IsFissionTrigger", &isFissionTrigger);
-      } else {
-        file = TFile::Open(fileName, "UPDATE");
-        tree = dynamic_cast<TTree *>(file->Get(treeName));
-        tree->SetBranchAddress("Event", &event);
-        tree->SetBranchAddress("TriggerID", &triggerID);
-        tree->SetBranchAddress("TriggerTS", &triggerTS);
-        tree->SetBranchAddress("Multiplicity", &multiplicity);
-        tree->SetBranchAddress("GammaMultiplicity", &gammaMultiplicity);
-        tree->SetBranchAddress("EJMultiplicity", &ejMultiplicity);
-        tree->SetBranchAddress("GSMultiplicity", &gsMultiplicity);
-        tree->SetBranchAddress("IsFissionTrigger", &isFissionTrigger);
-      }
-      tree->SetDirectory(file);
-
-      for (auto j = i; j < fHitVec->size(); j += nThreads) {
-        auto hit = THitData(fHitVec->at(j));
-        if (fChSettingsVec.at(hit.Board).at(hit.Channel).isEventTrigger) {
-          bool fillingFlag = true;
-
-          triggerID = fChSettingsVec.at(hit.Board).at(hit.Channel).detectorID;
-          triggerTS = hit.Timestamp;
-          multiplicity = 0;
-          gammaMultiplicity = 0;
-          ejMultiplicity = 0;
-          gsMultiplicity = 0;
-          isFissionTrigger = false;
-          auto isHitFront = false;
-          auto isHitBack = false;
-
-          if(hit.Board == 0) isHitFront = true;
-          if(hit.Board == 1) isHitBack = true;
-
-          double eneSum = GetCalibratedEnergy(
-              fChSettingsVec.at(hit.Board).at(hit.Channel), hit.Energy);
-
-          const Double_t eventTS = triggerTS;
-          event->emplace_back(hit.Board, hit.Channel, 0, hit.Energy,
-                              hit.EnergyShort);
-          multiplicity++;
-          if (triggerID < 34) {
-            gammaMultiplicity++;
-          } else if (47 < triggerID && triggerID < 85) {
-            ejMultiplicity++;
-          } else if (86 < triggerID && triggerID < 112) {
-            gsMultiplicity++;
-          }
-          // Search for hits in the past
-          if (fillingFlag && j > 0) {
-            for (auto k = j - 1; k >= 0; k--) {
-              auto hitPast = THitData(fHitVec->at(k));
-              if (hitPast.Timestamp < eventTS - fTimeWindow / 2) {
-                break;
-              }
-              int32_t detectorID = fChSettingsVec.at(hitPast.Board)
-                                       .at(hitPast.Channel)
-                                       .detectorID;
-              if (fIsTriggerDetector.at(detectorID) &&
-                  detectorID <= triggerID) {  // reject same detector also
-                fillingFlag = false;
-                break;
-              }
-
-              event->emplace_back(hitPast.Board, hitPast.Channel,
-                                  hitPast.Timestamp - eventTS, hitPast.Energy,
-                                  hitPast.EnergyShort);
-
-              eneSum += GetCalibratedEnergy(
-                  fChSettingsVec.at(hitPast.Board).at(hitPast.Channel),
-                  hitPast.Energy);
-
-              if(hitPast.Board == 0) isHitFront = true;
-              if(hitPast.Board == 1) isHitBack = true;
-
-              auto id = hitPast.Board * 16 + hitPast.Channel;
-              multiplicity++;
-              if (id < 34) {
-                gammaMultiplicity++;
-              } else if (47 < id && id < 85) {
-                ejMultiplicity++;
-              } else if (86 < id && id < 112) {
-                gsMultiplicity++;
-              }
+    threads.emplace_back([this, i, chunkSize, &queue]() {
+      auto &writer = fWriters.at(fIsSingleOutput ? 0 : i);
+      uint64_t nEvents = 0;
+      double waitTime = 0.;
+      const auto startTime = std::chrono::steady_clock::now();
+
+      uint64_t chunk;
+      while (queue.Pop(i, chunk)) {
+        auto block = std::make_unique<TEventBlock>(
+            fLayout != EventLayout::HitRef, fHitOffset);
+
+        // The window reaches out of the chunk to the neighbouring hits
+        TTriggerWindow window(*fHitVec, fChannelTable, fTimeWindow);
+        const auto first = fTriggerBegin + chunk * chunkSize;
+        const auto last = std::min(first + chunkSize, fTriggerEnd);
+        for (auto j = first; j < last; j++) {
+          const auto &trgInfo =
+              fChannelTable.Get(fHitVec->Board[j], fHitVec->Channel[j]);
+          if (trgInfo.isEventTrigger) {
+            window.MoveTo(j);
+            // Reject same detector in the past, but not in the future
+            if (window.IsRejected(trgInfo.detectorID)) continue;
+            if (!Policy::IsAccepted(window)) continue;
+
+            const auto triggerTS = fHitVec->Timestamp[j];
+            double eneSum = 0.;
+
+            // Plain column reads.  No THitData until the event is written.
+            uint32_t nHits[kNCategories] = {};
+            for (auto k = window.Begin(); k < window.End(); k++) {
+              const auto &info =
+                  fChannelTable.Get(fHitVec->Board[k], fHitVec->Channel[k]);
+              eneSum += info.GetCalibratedEnergy(fHitVec->Energy[k]);
+              nHits[Policy::Classify(info, trgInfo)]++;
             }
-          }
 
-          // Search for hits in the future
-          if (fillingFlag && j + 1 < fHitVec->size()) {
-            for (auto k = j + 1; k < fHitVec->size(); k++) {
-              auto hitFuture = THitData(fHitVec->at(k));
-              if (hitFuture.Timestamp > eventTS + fTimeWindow / 2) {
-                break;
-              }
-              int32_t detectorID = fChSettingsVec.at(hitFuture.Board)
-                                       .at(hitFuture.Channel)
-                                       .detectorID;
-              // Do not reject same detector
-              if (fIsTriggerDetector.at(detectorID) && detectorID < triggerID) {
-                fillingFlag = false;
-                break;
-              }
-
-              event->emplace_back(hitFuture.Board, hitFuture.Channel,
-                                  hitFuture.Timestamp - eventTS,
-                                  hitFuture.Energy, hitFuture.EnergyShort);
-
-              eneSum += GetCalibratedEnergy(
-                  fChSettingsVec.at(hitFuture.Board).at(hitFuture.Channel),
-                  hitFuture.Energy);
-
-              if(hitFuture.Board == 0) isHitFront = true;
-              if(hitFuture.Board == 1) isHitBack = true;
-
-              auto id = hitFuture.Board * 16 + hitFuture.Channel;
-              multiplicity++;
-              if (id < 34) {
-                gammaMultiplicity++;
-              } else if (47 < id && id < 85) {
-                ejMultiplicity++;
-              } else if (86 < id && id < 112) {
-                gsMultiplicity++;
-              }
-            }
-          }
-
-          if (fillingFlag && isHitFront && isHitBack) {
-            std::sort(event->begin(), event->end(),
-                      [](const THitData &a, const THitData &b) {
-                        return a.Timestamp < b.Timestamp;
-                      });
-
-            if (multiplicity > 2 && eneSum > 1000 && gammaMultiplicity > 0)
-              isFissionTrigger = true;
+            const bool isFissionTrigger = Policy::IsFissionTrigger(
+                window.Size(), eneSum, nHits[kGamma]);
+            if (!Policy::IsToBeFilled(isFissionTrigger)) continue;
 
-            // if (isFissionTrigger) tree->Fill();
-            tree->Fill();
+            block->AddEvent(*fHitVec, window.Begin(), window.End(), j,
+                            trgInfo.detectorID, triggerTS, window.Size(),
+                            nHits[kGamma], nHits[kEJ], nHits[kGS],
+                            isFissionTrigger);
+            nEvents++;
           }
+        }
 
-          event->clear();
+        // Waiting for a full writer queue is not search time
+        const auto pushTime = std::chrono::steady_clock::now();
+        if (fIsSingleOutput) {
+          // Also the empty blocks, to keep the sequence without gaps
+          writer->PushOrdered(fChunkSequence + chunk, std::move(block));
+        } else if (block->GetNEvents() > 0) {
+          writer->Push(std::move(block));
         }
+        waitTime += std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - pushTime)
+                        .count();
       }
 
-      tree->Write();
-      // file->Close();
-      delete file;
+      const auto searchTime =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                        startTime)
+              .count() -
+          waitTime;
+      AddProfile(searchTime, waitTime, nEvents);
     });
   }
 
   for (auto &thread : threads) {
     thread.join();
   }
-
-  fHitVec->clear();
-  // fHitVec->reset();
+  fChunkSequence += nChunks;
 }
 
-void TEventBuilder::SearchAndWriteFissionEvents(uint32_t nThreads,
-                                                bool firstRun)
+void TEventBuilder::LoadHits(uint32_t nFiles, uint32_t nThreads,
+                             TBoundedQueue<std::unique_ptr<THitStore>> &queue)
 {
-  // ROOT::EnableThreadSafety();
+  auto hitLoader = THitLoader(fChSettingsVec);
 
-  std::vector<std::thread> threads;
-  for (auto i = 0; i < nThreads; i++) {
-    threads.emplace_back([this, i, nThreads, firstRun]() {
-      auto fileName = Form("event_t%d.root", i);
-      auto treeName = Form("Event_Tree");
-      TFile *file = nullptr;
-      TTree *tree = nullptr;
-      std::vector<THitData> *event = new std::vector<THitData>();
-      UChar_t triggerID;
-      Double_t triggerTS;
-      UChar_t multiplicity;
-      UChar_t gammaMultiplicity;
-      UChar_t ejMultiplicity;
-      UChar_t gsMultiplicity;
-      Bool_t isFissionTrigger;
-      if (firstRun) {
-        file = TFile::Open(fileName, "RECREATE");
-        tree = new TTree(treeName, "Event Tree");
-        tree->Branch("Event", &event);
-        tree->Branch("TriggerID", &triggerID);
-        tree->Branch("TriggerTS", &triggerTS);
-        tree->Branch("Multiplicity", &multiplicity);
-        tree->Branch("GammaMultiplicity", &gammaMultiplicity);
-        tree->Branch("EJMultiplicity", &ejMultiplicity);
-        tree->Branch("GSMultiplicity", &gsMultiplicity);
-        tree->Branch("IsFissionTrigger", &isFissionTrigger);
-      } else {
-        file = TFile::Open(fileName, "UPDATE");
-        tree = dynamic_cast<TTree *>(file->Get(treeName));
-        tree->SetBranchAddress("Event", &event);
-        tree->SetBranchAddress("TriggerID", &triggerID);
-        tree->SetBranchAddress("TriggerTS", &triggerTS);
-        tree->SetBranchAddress("Multiplicity", &multiplicity);
-        tree->SetBranchAddress("GammaMultiplicity", &gammaMultiplicity);
-        tree->SetBranchAddress("EJMultiplicity", &ejMultiplicity);
-        tree->SetBranchAddress("GSMultiplicity", &gsMultiplicity);
-        tree->SetBranchAddress("IsFissionTrigger", &isFissionTrigger);
-      }
-      tree->SetDirectory(file);
-
-      for (auto j = i; j < fHitVec->size(); j += nThreads) {
-        auto hit = THitData(fHitVec->at(j));
-        if (fChSettingsVec.at(hit.Board).at(hit.Channel).isEventTrigger) {
-          bool fillingFlag = true;
-
-          triggerID = fChSettingsVec.at(hit.Board).at(hit.Channel).detectorID;
-          triggerTS = hit.Timestamp;
-          multiplicity = 0;
-          gammaMultiplicity = 0;
-          ejMultiplicity = 0;
-          gsMultiplicity = 0;
-          isFissionTrigger = false;
-
-          double eneSum = GetCalibratedEnergy(
-              fChSettingsVec.at(hit.Board).at(hit.Channel), hit.Energy);
-
-          const Double_t eventTS = triggerTS;
-          event->emplace_back(hit.Board, hit.Channel, 0, hit.Energy,
-                              hit.EnergyShort);
-          multiplicity++;
-          if (31 < triggerID && triggerID < 66) {
-            gammaMultiplicity++;
-          } else if (79 < triggerID && triggerID < 117) {
-            ejMultiplicity++;
-          } else if (118 < triggerID && triggerID < 144) {
-            gsMultiplicity++;
-          }
-          // Search for hits in the past
-          if (fillingFlag && j > 0) {
-            for (auto k = j - 1; k >= 0; k--) {
-              auto hitPast = THitData(fHitVec->at(k));
-              if (hitPast.Timestamp < eventTS - fTimeWindow / 2) {
-                break;
-              }
-              int32_t detectorID = fChSettingsVec.at(hitPast.Board)
-                                       .at(hitPast.Channel)
-                                       .detectorID;
-              if (fIsTriggerDetector.at(detectorID) &&
-                  detectorID <= triggerID) {  // reject same detector also
-                fillingFlag = false;
-                break;
-              }
-
-              event->emplace_back(hitPast.Board, hitPast.Channel,
-                                  hitPast.Timestamp - eventTS, hitPast.Energy,
-                                  hitPast.EnergyShort);
-
-              eneSum += GetCalibratedEnergy(
-                  fChSettingsVec.at(hitPast.Board).at(hitPast.Channel),
-                  hitPast.Energy);
-
-              auto id = hitPast.Board * 16 + hitPast.Channel;
-              multiplicity++;
-              if (31 < triggerID && triggerID < 66) {
-                gammaMultiplicity++;
-              } else if (79 < triggerID && triggerID < 117) {
-                ejMultiplicity++;
-              } else if (118 < triggerID && triggerID < 144) {
-                gsMultiplicity++;
-              }
-            }
-          }
+  // A cache of an earlier run replaces the whole loading.  Otherwise a new
+  // cache is written from the loaded hits.
+  // With a time range, the hits one time window out of it are loaded too
+  const bool isTimeRange =
+      fTimeFrom > std::numeric_limits<Double_t>::lowest() ||
+      fTimeTo < std::numeric_limits<Double_t>::max();
+  auto loadFrom = fTimeFrom;
+  auto loadTo = fTimeTo;
+  if (isTimeRange) {
+    loadFrom = fTimeFrom - fTimeWindow;
+    loadTo = fTimeTo + fTimeWindow;
+  }
 
-          // Search for hits in the future
-          if (fillingFlag && j + 1 < fHitVec->size()) {
-            for (auto k = j + 1; k < fHitVec->size(); k++) {
-              auto hitFuture = THitData(fHitVec->at(k));
-              if (hitFuture.Timestamp > eventTS + fTimeWindow / 2) {
-                break;
-              }
-              int32_t detectorID = fChSettingsVec.at(hitFuture.Board)
-                                       .at(hitFuture.Channel)
-                                       .detectorID;
-              // Do not reject same detector
-              if (fIsTriggerDetector.at(detectorID) && detectorID < triggerID) {
-                fillingFlag = false;
-                break;
-              }
-
-              event->emplace_back(hitFuture.Board, hitFuture.Channel,
-                                  hitFuture.Timestamp - eventTS,
-                                  hitFuture.Energy, hitFuture.EnergyShort);
-
-              eneSum += GetCalibratedEnergy(
-                  fChSettingsVec.at(hitFuture.Board).at(hitFuture.Channel),
-                  hitFuture.Energy);
-
-              auto id = hitFuture.Board * 16 + hitFuture.Channel;
-              multiplicity++;
-              if (31 < triggerID && triggerID < 66) {
-                gammaMultiplicity++;
-              } else if (79 < triggerID && triggerID < 117) {
-                ejMultiplicity++;
-              } else if (118 < triggerID && triggerID < 144) {
-                gsMultiplicity++;
-              }
-            }
-          }
+  std::unique_ptr<THitCache> hitCache;
+  bool isCached = false;
+  if (!fCacheDir.empty()) {
+    hitCache = std::make_unique<THitCache>(fCacheDir, fFileList, fHitType,
+                                           fChSettingsVec, loadFrom, loadTo);
+    isCached = hitCache->Open();
+    if (isCached) {
+      std::cout << "Loading hits from " << hitCache->GetFileName()
+                << std::endl;
+      fFileList.clear();
+    } else if (!hitCache->Create()) {
+      hitCache.reset();
+    }
+  }
 
-          if (fillingFlag && multiplicity > 1) {
-            std::sort(event->begin(), event->end(),
-                      [](const THitData &a, const THitData &b) {
-                        return a.Timestamp < b.Timestamp;
-                      });
+  if (isTimeRange) {
+    hitLoader.SetTimeRange(loadFrom, loadTo);
+    fFileList = hitLoader.SelectFiles(fFileList, fHitType);
+  }
 
-            if (multiplicity > 2 && eneSum > 1000 && gammaMultiplicity > 0)
-              isFissionTrigger = true;
+  const bool isStreaming =
+      !isCached && fStreamChunkSize > 0 && fMemoryBudget == 0;
+  if (isStreaming) {
+    hitLoader.OpenStream(fFileList, fHitType, nFiles);
+    fFileList.clear();
+  }
 
-            // if (isFissionTrigger) tree->Fill();
-            tree->Fill();
-          }
+  double loadTime = 0.;
+
+  // External sort: spill every sorted batch, then merge all of them.  A
+  // batch takes files up to the hits sortable within the budget, and at
+  // most nFiles.  The merged chunks are in memory while being merged,
+  // queued and searched.
+  std::unique_ptr<TExternalSort> externalSort;
+  if (!isCached && fMemoryBudget > 0) {
+    const auto start = std::chrono::steady_clock::now();
+    externalSort = std::make_unique<TExternalSort>(
+        fScratchDir, fMemoryBudget, kLoadQueueSize + 2);
+    const auto batchSize = externalSort->GetBatchSize();
+    const auto nHits = hitLoader.CountHits(fFileList, nThreads, fHitType);
+    std::size_t iFile = 0;
+    while (iFile < fFileList.size()) {
+      std::vector<std::string> fileList;
+      uint64_t nBatchHits = 0;
+      while (iFile < fFileList.size() &&
+             (fileList.empty() || (fileList.size() < nFiles &&
+                                   nBatchHits + nHits[iFile] <= batchSize))) {
+        nBatchHits += nHits[iFile];
+        fileList.push_back(fFileList[iFile++]);
+      }
+      if (nBatchHits > batchSize) {
+        std::cerr << fileList.front() << " has more hits than can be sorted "
+                  << "within the memory budget." << std::endl;
+      }
+      auto hitVec = hitLoader.LoadHitsMT(fileList, nThreads, fHitType);
+      if (!externalSort->AddRun(*hitVec)) {
+        std::cerr << "Spilling stopped, the remaining files are skipped."
+                  << std::endl;
+        break;
+      }
+    }
+    fFileList.clear();
+    std::cout << "Merging " << externalSort->GetNRuns() << " runs"
+              << std::endl;
+    externalSort->StartMerge();
+    loadTime += std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  }
 
-          event->clear();
+  while (true) {
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<THitStore> hitVec;
+    if (isCached) {
+      hitVec = hitCache->LoadNextHits();
+    } else if (externalSort) {
+      hitVec = externalSort->LoadNextHits(externalSort->GetChunkSize());
+    } else if (isStreaming) {
+      hitVec = hitLoader.LoadNextHits(fStreamChunkSize, nThreads);
+    } else if (fFileList.size() > 0) {
+      std::vector<std::string> fileList;
+      for (auto i = 0; i < nFiles; i++) {
+        if (fFileList.size() == 0) {
+          break;
         }
+        fileList.push_back(fFileList.front());
+        fFileList.erase(fFileList.begin());
       }
+      hitVec = hitLoader.LoadHitsMT(fileList, nThreads, fHitType);
+    } else {
+      break;
+    }
+    loadTime += std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    if (hitVec->size() > 0) {
+      std::cout << hitVec->size() << " hits loaded" << std::endl;
+      if (hitCache && !isCached) hitCache->Write(*hitVec);
+      queue.Push(std::move(hitVec));
+    } else if (isCached || isStreaming || externalSort) {
+      break;
+    }
+  }
+  if (hitCache && !isCached) hitCache->Commit();
+  queue.Close();
 
-      tree->Write();
-      // file->Close();
-      delete file;
-    });
+  std::lock_guard<std::mutex> lock(fProfileMutex);
+  fLoadTime += loadTime;
+}
+
+void TEventBuilder::BuildEvent(uint32_t nFiles, uint32_t nThreads)
+{
+  ROOT::EnableThreadSafety();
+
+  fWriters.clear();
+  bool isImplicitMT = false;
+  if (fIsSingleOutput) {
+    // The one writer compresses the baskets of its branches in parallel, on
+    // the cores not used by the builder, loader and writer threads
+    const auto nCores = std::thread::hardware_concurrency();
+    const auto nUsed = nThreads + 2;
+    if (nCores > nUsed + 1 && !ROOT::IsImplicitMTEnabled()) {
+      ROOT::EnableImplicitMT(nCores - nUsed);
+      isImplicitMT = true;
+    }
+    fWriters.emplace_back(std::make_unique<TEventWriter>(
+        "events.root", kWriteQueueSize * nThreads, fLayout, fWriteSettings));
+  } else {
+    for (auto i = 0; i < nThreads; i++) {
+      fWriters.emplace_back(std::make_unique<TEventWriter>(
+          Form("event_t%d.root", i), kWriteQueueSize, fLayout,
+          fWriteSettings));
+    }
+  }
+  fChunkSequence = 0;
+  fHitOffset = 0;
+  if (fLayout == EventLayout::HitRef) {
+    fHitTableWriter =
+        std::make_unique<THitTableWriter>("hits.root", fWriteSettings);
   }
+  fLoadTime = fLoadWaitTime = fSearchTime = fSearchWaitTime = 0.;
+  fNEvents = 0;
+
+  TBoundedQueue<std::unique_ptr<THitStore>> loadQueue(kLoadQueueSize);
+  std::thread loadThread(&TEventBuilder::LoadHits, this, nFiles, nThreads,
+                         std::ref(loadQueue));
+
+  // Hits of the last fTimeWindow are carried over to the next loop.
+  // Triggers in the last half window are built in the next loop, when the
+  // hits after them are loaded.  The loop boundary does not lose any hits.
+  auto carryVec = std::make_unique<THitStore>();
+  Timestamp_t builtTS = kMinTimestamp;
+  Long64_t nTableHits = 0;  // Entries of the hit table
+  uint64_t nTableCopies = 0;  // Carried hits written to the table again
+  const auto timeFrom = NsToTicks(fTimeFrom);
+  const auto timeTo = NsToTicks(fTimeTo);
 
-  for (auto &thread : threads) {
-    thread.join();
+  while (true) {
+    std::unique_ptr<THitStore> hitVec;
+    const bool isLast = !loadQueue.Pop(hitVec);
+    if (isLast) {
+      hitVec = std::make_unique<THitStore>();
+    }
+
+    // The carried hits are the last entries of the hit table already.  If
+    // the batch starts before the carry ends, they are mixed with the new
+    // hits.  An event can then hold both, so the whole store is written
+    // again to keep its hits contiguous: the carried hits are in the table
+    // twice, and the table is not time ordered across the loop boundary.
+    std::size_t nTableHead = 0;
+    if (hitVec->empty() ||
+        (!carryVec->empty() &&
+         carryVec->Timestamp.back() <= hitVec->Timestamp.front())) {
+      nTableHead = carryVec->size();
+    } else if (fHitTableWriter) {
+      nTableCopies += carryVec->size();
+    }
+
+    // The batch is taken over, not copied.  The carry is merged into its
+    // head.
+    hitVec->MergeFront(*carryVec);
+    fHitVec = std::move(hitVec);
+    carryVec.reset();
+    if (fHitVec->size() == 0) {
+      break;
+    }
+
+    auto endTS = kMaxTimestamp;
+    if (!isLast) {
+      endTS = std::max(builtTS, fHitVec->Timestamp.back() - fHalfWindow);
+    }
+    fTriggerBegin = fHitVec->LowerBound(std::max(builtTS, timeFrom));
+    fTriggerEnd = std::max(fTriggerBegin,
+                           fHitVec->LowerBound(std::min(endTS, timeTo)));
+
+    // The hit table is filled while the events are searched.  Both only
+    // read fHitVec.
+    std::thread hitTableThread;
+    if (fHitTableWriter) {
+      fHitOffset = nTableHits - nTableHead;
+      hitTableThread = std::thread([this, nTableHead]() {
+        fHitTableWriter->Write(*fHitVec, nTableHead);
+      });
+    }
+    if (fHitType == HitFileType::ELIGANT) {
+      SearchEvents<TELIGANTPolicy>(nThreads);
+    } else {
+      SearchEvents<TFissionPolicy>(nThreads);
+    }
+    if (hitTableThread.joinable()) hitTableThread.join();
+    nTableHits += fHitVec->size() - nTableHead;
+    builtTS = endTS;
+
+    if (isLast) {
+      break;
+    }
+    carryVec = std::make_unique<THitStore>();
+    carryVec->Append(*fHitVec, fHitVec->LowerBound(endTS - fHalfWindow),
+                     fHitVec->size());
+    fHitVec.reset();
   }
+  fHitVec.reset();
+
+  loadThread.join();
+  fLoadWaitTime = loadQueue.GetPushWaitTime();
+  fSearchWaitTime += loadQueue.GetPopWaitTime();
+  for (auto &writer : fWriters) {
+    writer->Close();
+  }
+  if (fHitTableWriter) fHitTableWriter->Close();
+  if (isImplicitMT) ROOT::DisableImplicitMT();
+  if (nTableCopies > 0) {
+    std::cerr << nTableCopies << " carried hits are in hits.root twice, the "
+              << "hit batches overlap in time.  Read Hit_Table through "
+              << "Event_Table." << std::endl;
+  }
+  PrintProfile();
+  fWriters.clear();
+  fHitTableWriter.reset();
+}
 
-  fHitVec->clear();
-  // fHitVec->reset();
+void TEventBuilder::AddProfile(double searchTime, double waitTime,
+                              uint64_t nEvents)
+{
+  std::lock_guard<std::mutex> lock(fProfileMutex);
+  fSearchTime += searchTime;
+  fSearchWaitTime += waitTime;
+  fNEvents += nEvents;
+}
+
+void TEventBuilder::PrintProfile()
+{
+  double writeTime = 0.;
+  double writeWaitTime = 0.;
+  for (auto &writer : fWriters) {
+    writeTime += writer->GetBusyTime();
+    writeWaitTime += writer->GetWaitTime();
+  }
+  if (fHitTableWriter) writeTime += fHitTableWriter->GetBusyTime();
+
+  std::lock_guard<std::mutex> lock(fProfileMutex);
+  std::cout << fNEvents << " events built" << std::endl;
+  std::cout << "Stage\tbusy [s]\twait [s] (sum of threads)" << std::endl;
+  std::cout << "Load\t" << fLoadTime << "\t" << fLoadWaitTime << std::endl;
+  std::cout << "Build\t" << fSearchTime << "\t" << fSearchWaitTime
+            << std::endl;
+  std::cout << "Write\t" << writeTime << "\t" << writeWaitTime << std::endl;
+  if (fNEvents > 0) {
+    std::cout << (fSearchTime + writeTime) / fNEvents * 1.e9
+              << " ns/event for build and write" << std::endl;
+  }
 }
@@ -0,0 +1,236 @@
+#include "TEventReader.hpp"
+
+#include <TKey.h>
+#include <TList.h>
+#include <TParameter.h>
+
+#include <iostream>
+#include <utility>
+
+#ifdef USE_RNTUPLE
+#include <RVersion.h>
+
+#include <ROOT/RNTupleReader.hxx>
+// RNTuple left ROOT::Experimental in 6.36
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 35, 0)
+namespace RNTupleAPI = ROOT;
+#else
+namespace RNTupleAPI = ROOT::Experimental;
+#endif
+
+// Field view of RNTupleReader::GetView<T>
+template <class T>
+using NTupleView_t =
+    decltype(std::declval<RNTupleAPI::RNTupleReader &>().GetView<T>(""));
+
+struct TEventReader::NTupleState {
+  NTupleState(std::unique_ptr<RNTupleAPI::RNTupleReader> reader)
+      : Reader(std::move(reader)),
+        Board(Reader->GetView<std::vector<UChar_t>>("Board")),
+        Channel(Reader->GetView<std::vector<UChar_t>>("Channel")),
+        DT(Reader->GetView<std::vector<Double_t>>("dT")),
+        Energy(Reader->GetView<std::vector<UShort_t>>("Energy")),
+        EnergyShort(Reader->GetView<std::vector<UShort_t>>("EnergyShort")),
+        TriggerID(Reader->GetView<UChar_t>("TriggerID")),
+        TriggerTS(Reader->GetView<Double_t>("TriggerTS")),
+        Multiplicity(Reader->GetView<UChar_t>("Multiplicity")),
+        GammaMultiplicity(Reader->GetView<UChar_t>("GammaMultiplicity")),
+        EJMultiplicity(Reader->GetView<UChar_t>("EJMultiplicity")),
+        GSMultiplicity(Reader->GetView<UChar_t>("GSMultiplicity")),
+        IsFissionTrigger(Reader->GetView<bool>("IsFissionTrigger"))
+  {};
+
+  std::unique_ptr<RNTupleAPI::RNTupleReader> Reader;
+  NTupleView_t<std::vector<UChar_t>> Board;
+  NTupleView_t<std::vector<UChar_t>> Channel;
+  NTupleView_t<std::vector<Double_t>> DT;
+  NTupleView_t<std::vector<UShort_t>> Energy;
+  NTupleView_t<std::vector<UShort_t>> EnergyShort;
+  NTupleView_t<UChar_t> TriggerID;
+  NTupleView_t<Double_t> TriggerTS;
+  NTupleView_t<UChar_t> Multiplicity;
+  NTupleView_t<UChar_t> GammaMultiplicity;
+  NTupleView_t<UChar_t> EJMultiplicity;
+  NTupleView_t<UChar_t> GSMultiplicity;
+  NTupleView_t<bool> IsFissionTrigger;
+};
+#else
+struct TEventReader::NTupleState {
+};
+#endif
+
+TEventReader::TEventReader(std::string fileName, std::string hitFileName)
+{
+  fEvent = new std::vector<THitData>();
+
+  fFile = TFile::Open(fileName.c_str(), "READ");
+  if (!fFile) {
+    std::cerr << "File not found: " << fileName << std::endl;
+    return;
+  }
+
+  if (fFile->Get("Event_Table")) {
+    fLayout = EventLayout::HitRef;
+    fFile->Close();
+    delete fFile;
+    fFile = nullptr;
+    fHitRefReader =
+        std::make_unique<THitRefEventReader>(fileName, hitFileName);
+    if (!fHitRefReader->IsOpen()) fHitRefReader.reset();
+    return;
+  }
+
+  auto key = fFile->GetKey("Event_Tree");
+  if (key && TString(key->GetClassName()).Contains("RNTuple")) {
+    fLayout = EventLayout::RNTuple;
+    fFile->Close();
+    delete fFile;
+    fFile = nullptr;
+    OpenNTuple(fileName);
+    return;
+  }
+
+  fTree = dynamic_cast<TTree *>(fFile->Get("Event_Tree"));
+  if (!fTree) {
+    std::cerr << "No Event_Tree found: " << fileName << std::endl;
+    return;
+  }
+
+  // No version: the files before the flat layout
+  fSchemaVersion = 1;
+  auto version = dynamic_cast<TParameter<Int_t> *>(
+      fTree->GetUserInfo()->FindObject(kEventSchemaKey));
+  if (version) fSchemaVersion = version->GetVal();
+  if (fSchemaVersion > kEventSchemaVersion) {
+    std::cerr << "Event schema version " << fSchemaVersion
+              << " is newer than this reader (" << kEventSchemaVersion
+              << ")" << std::endl;
+    fTree = nullptr;
+    return;
+  }
+
+  if (fSchemaVersion == 1) {
+    fLayout = EventLayout::Object;
+    fTree->SetBranchAddress("Event", &fEvent);
+  } else {
+    fLayout = EventLayout::Flat;
+    fTree->SetBranchAddress("nHits", &fNHits);
+    ResizeFlatColumns(kFlatColumnSize);
+  }
+  fTree->SetBranchAddress("TriggerID", &TriggerID);
+  fTree->SetBranchAddress("TriggerTS", &TriggerTS);
+  fTree->SetBranchAddress("Multiplicity", &Multiplicity);
+  fTree->SetBranchAddress("GammaMultiplicity", &GammaMultiplicity);
+  fTree->SetBranchAddress("EJMultiplicity", &EJMultiplicity);
+  fTree->SetBranchAddress("GSMultiplicity", &GSMultiplicity);
+  fTree->SetBranchAddress("IsFissionTrigger", &IsFissionTrigger);
+}
+
+TEventReader::~TEventReader()
+{
+  if (fFile) {
+    fFile->Close();
+    delete fFile;
+  }
+  delete fEvent;
+}
+
+bool TEventReader::IsOpen() const
+{
+  return fTree || fHitRefReader || fNTuple;
+}
+
+void TEventReader::OpenNTuple(std::string fileName)
+{
+#ifdef USE_RNTUPLE
+  fNTuple = std::make_unique<NTupleState>(
+      RNTupleAPI::RNTupleReader::Open("Event_Tree", fileName));
+#else
+  std::cerr << "No RNTuple support in this build: " << fileName
+            << std::endl;
+#endif
+}
+
+void TEventReader::GetNTupleEntry(Long64_t i)
+{
+#ifdef USE_RNTUPLE
+  auto &nt = *fNTuple;
+  const auto &board = nt.Board(i);
+  const auto &channel = nt.Channel(i);
+  const auto &dT = nt.DT(i);
+  const auto &energy = nt.Energy(i);
+  const auto &energyShort = nt.EnergyShort(i);
+  fEvent->clear();
+  for (std::size_t k = 0; k < board.size(); k++) {
+    fEvent->emplace_back(board[k], channel[k], dT[k], energy[k],
+                         energyShort[k]);
+  }
+  TriggerID = nt.TriggerID(i);
+  TriggerTS = nt.TriggerTS(i);
+  Multiplicity = nt.Multiplicity(i);
+  GammaMultiplicity = nt.GammaMultiplicity(i);
+  EJMultiplicity = nt.EJMultiplicity(i);
+  GSMultiplicity = nt.GSMultiplicity(i);
+  IsFissionTrigger = nt.IsFissionTrigger(i);
+#endif
+}
+
+void TEventReader::ResizeFlatColumns(std::size_t nHits)
+{
+  fBoard.resize(nHits);
+  fChannel.resize(nHits);
+  fDT.resize(nHits);
+  fEnergy.resize(nHits);
+  fEnergyShort.resize(nHits);
+  fTree->SetBranchAddress("Board", fBoard.data());
+  fTree->SetBranchAddress("Channel", fChannel.data());
+  fTree->SetBranchAddress("dT", fDT.data());
+  fTree->SetBranchAddress("Energy", fEnergy.data());
+  fTree->SetBranchAddress("EnergyShort", fEnergyShort.data());
+}
+
+Long64_t TEventReader::GetEntries() const
+{
+  if (fHitRefReader) return fHitRefReader->GetEntries();
+#ifdef USE_RNTUPLE
+  if (fNTuple) return fNTuple->Reader->GetNEntries();
+#endif
+  return fTree ? fTree->GetEntries() : 0;
+}
+
+void TEventReader::GetEntry(Long64_t i)
+{
+  if (fHitRefReader) {
+    fHitRefReader->GetEntry(i);
+    *fEvent = fHitRefReader->GetEvent();
+    TriggerID = fHitRefReader->TriggerID;
+    TriggerTS = fHitRefReader->TriggerTS;
+    Multiplicity = fHitRefReader->Multiplicity;
+    GammaMultiplicity = fHitRefReader->GammaMultiplicity;
+    EJMultiplicity = fHitRefReader->EJMultiplicity;
+    GSMultiplicity = fHitRefReader->GSMultiplicity;
+    IsFissionTrigger = fHitRefReader->IsFissionTrigger;
+    return;
+  }
+  if (fLayout == EventLayout::RNTuple) {
+    GetNTupleEntry(i);
+    return;
+  }
+  if (!fTree) return;
+
+  if (fLayout == EventLayout::Object) {
+    fTree->GetEntry(i);
+    return;
+  }
+
+  // The size is known only after nHits is read
+  fTree->GetBranch("nHits")->GetEntry(i);
+  if (fNHits > fDT.size()) ResizeFlatColumns(2 * fNHits);
+  fTree->GetEntry(i);
+
+  fEvent->clear();
+  for (auto k = 0; k < fNHits; k++) {
+    fEvent->emplace_back(fBoard[k], fChannel[k], fDT[k], fEnergy[k],
+                         fEnergyShort[k]);
+  }
+}
@@ -0,0 +1,280 @@
+#include "TEventWriter.hpp"
+
+#include <TList.h>
+#include <TParameter.h>
+#include <TROOT.h>
+
+#include <chrono>
+#include <iostream>
+
+#ifdef USE_RNTUPLE
+#include <RVersion.h>
+
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleWriter.hxx>
+// RNTuple left ROOT::Experimental in 6.36
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 35, 0)
+namespace RNTupleAPI = ROOT;
+#else
+namespace RNTupleAPI = ROOT::Experimental;
+#endif
+
+// The values of the default entry of the model
+struct TEventWriter::NTupleState {
+  std::unique_ptr<RNTupleAPI::RNTupleWriter> Writer;
+  std::shared_ptr<std::vector<UChar_t>> Board;
+  std::shared_ptr<std::vector<UChar_t>> Channel;
+  std::shared_ptr<std::vector<Double_t>> DT;
+  std::shared_ptr<std::vector<UShort_t>> Energy;
+  std::shared_ptr<std::vector<UShort_t>> EnergyShort;
+  std::shared_ptr<UChar_t> TriggerID;
+  std::shared_ptr<Double_t> TriggerTS;
+  std::shared_ptr<UChar_t> Multiplicity;
+  std::shared_ptr<UChar_t> GammaMultiplicity;
+  std::shared_ptr<UChar_t> EJMultiplicity;
+  std::shared_ptr<UChar_t> GSMultiplicity;
+  std::shared_ptr<bool> IsFissionTrigger;
+};
+#else
+struct TEventWriter::NTupleState {
+};
+#endif
+
+TEventWriter::TEventWriter(std::string fileName, uint32_t queueSize,
+                           EventLayout layout, WriteSettings_t settings)
+    : fFileName(fileName),
+      fLayout(layout),
+      fSettings(settings),
+      fQueue(queueSize)
+{
+  fEvent = new std::vector<THitData>();
+
+#ifndef USE_RNTUPLE
+  if (fLayout == EventLayout::RNTuple) {
+    std::cerr << "No RNTuple support in this build, writing TTree"
+              << std::endl;
+    fLayout = EventLayout::Flat;
+  }
+#endif
+  if (fLayout == EventLayout::RNTuple) {
+    OpenNTuple();
+  } else {
+    OpenTree();
+  }
+
+  fThread = std::thread(&TEventWriter::WriteLoop, this);
+}
+
+TEventWriter::~TEventWriter()
+{
+  Close();
+  delete fEvent;
+}
+
+void TEventWriter::OpenTree()
+{
+  fFile = TFile::Open(fFileName.c_str(), "RECREATE");
+  ApplyWriteSettings(fFile, fSettings);
+  if (fLayout == EventLayout::HitRef) {
+    fTree = new TTree("Event_Table", "Event Table");
+    fTree->Branch("FirstHit", &fFirstHit);
+    fTree->Branch("NHits", &fNHits);
+    fTree->Branch("TriggerIndex", &fTriggerIndex);
+  } else if (fLayout == EventLayout::Object) {
+    fTree = new TTree("Event_Tree", "Event Tree");
+    fTree->Branch("Event", &fEvent);
+  } else {
+    // One branch per column, each compressed and read on its own
+    fTree = new TTree("Event_Tree", "Event Tree");
+    fTree->GetUserInfo()->Add(
+        new TParameter<Int_t>(kEventSchemaKey, kEventSchemaVersion));
+    fBoard.resize(kFlatColumnSize);
+    fChannel.resize(kFlatColumnSize);
+    fDT.resize(kFlatColumnSize);
+    fEnergy.resize(kFlatColumnSize);
+    fEnergyShort.resize(kFlatColumnSize);
+    fTree->Branch("nHits", &fNHits, "nHits/i");
+    fTree->Branch("Board", fBoard.data(), "Board[nHits]/b");
+    fTree->Branch("Channel", fChannel.data(), "Channel[nHits]/b");
+    fTree->Branch("dT", fDT.data(), "dT[nHits]/D");
+    fTree->Branch("Energy", fEnergy.data(), "Energy[nHits]/s");
+    fTree->Branch("EnergyShort", fEnergyShort.data(),
+                  "EnergyShort[nHits]/s");
+  }
+  fTree->Branch("TriggerID", &fTriggerID);
+  fTree->Branch("TriggerTS", &fTriggerTS);
+  fTree->Branch("Multiplicity", &fMultiplicity);
+  fTree->Branch("GammaMultiplicity", &fGammaMultiplicity);
+  fTree->Branch("EJMultiplicity", &fEJMultiplicity);
+  fTree->Branch("GSMultiplicity", &fGSMultiplicity);
+  fTree->Branch("IsFissionTrigger", &fIsFissionTrigger);
+  ApplyWriteSettings(fTree, fSettings);
+  fTree->SetDirectory(fFile);
+}
+
+void TEventWriter::OpenNTuple()
+{
+#ifdef USE_RNTUPLE
+  fNTuple = std::make_unique<NTupleState>();
+  auto &nt = *fNTuple;
+  auto model = RNTupleAPI::RNTupleModel::Create();
+  nt.Board = model->MakeField<std::vector<UChar_t>>("Board");
+  nt.Channel = model->MakeField<std::vector<UChar_t>>("Channel");
+  nt.DT = model->MakeField<std::vector<Double_t>>("dT");
+  nt.Energy = model->MakeField<std::vector<UShort_t>>("Energy");
+  nt.EnergyShort = model->MakeField<std::vector<UShort_t>>("EnergyShort");
+  nt.TriggerID = model->MakeField<UChar_t>("TriggerID");
+  nt.TriggerTS = model->MakeField<Double_t>("TriggerTS");
+  nt.Multiplicity = model->MakeField<UChar_t>("Multiplicity");
+  nt.GammaMultiplicity = model->MakeField<UChar_t>("GammaMultiplicity");
+  nt.EJMultiplicity = model->MakeField<UChar_t>("EJMultiplicity");
+  nt.GSMultiplicity = model->MakeField<UChar_t>("GSMultiplicity");
+  nt.IsFissionTrigger = model->MakeField<bool>("IsFissionTrigger");
+  // No baskets in RNTuple.  Negative auto flush is the cluster size.
+  RNTupleAPI::RNTupleWriteOptions options;
+  if (fSettings.compression >= 0) {
+    options.SetCompression(fSettings.compression);
+  }
+  if (fSettings.autoFlush < 0) {
+    options.SetApproxZippedClusterSize(-fSettings.autoFlush);
+  }
+  nt.Writer = RNTupleAPI::RNTupleWriter::Recreate(
+      std::move(model), "Event_Tree", fFileName, options);
+#endif
+}
+
+void TEventWriter::FillNTuple(const TEventBlock &block, std::size_t i)
+{
+#ifdef USE_RNTUPLE
+  auto &nt = *fNTuple;
+  const auto &hits = block.Hits;
+  const auto first = block.FirstHit[i];
+  const auto last = block.FirstHit[i + 1];
+  nt.Board->assign(hits.Board.begin() + first, hits.Board.begin() + last);
+  nt.Channel->assign(hits.Channel.begin() + first,
+                     hits.Channel.begin() + last);
+  nt.DT->clear();
+  for (auto k = first; k < last; k++) {
+    nt.DT->push_back(TicksToNs(hits.Timestamp[k]));
+  }
+  nt.Energy->assign(hits.Energy.begin() + first, hits.Energy.begin() + last);
+  nt.EnergyShort->assign(hits.EnergyShort.begin() + first,
+                         hits.EnergyShort.begin() + last);
+  *nt.TriggerID = block.TriggerID[i];
+  *nt.TriggerTS = TicksToNs(block.TriggerTS[i]);
+  *nt.Multiplicity = block.Multiplicity[i];
+  *nt.GammaMultiplicity = block.GammaMultiplicity[i];
+  *nt.EJMultiplicity = block.EJMultiplicity[i];
+  *nt.GSMultiplicity = block.GSMultiplicity[i];
+  *nt.IsFissionTrigger = block.IsFissionTrigger[i];
+  nt.Writer->Fill();
+#endif
+}
+
+void TEventWriter::Push(std::unique_ptr<TEventBlock> block)
+{
+  fQueue.Push(std::move(block));
+}
+
+void TEventWriter::PushOrdered(uint64_t sequence,
+                               std::unique_ptr<TEventBlock> block)
+{
+  // Holding the lock while the queue is full makes the other builder
+  // threads wait too, which keeps fPendingBlocks small
+  std::lock_guard<std::mutex> lock(fOrderMutex);
+  fPendingBlocks.emplace(sequence, std::move(block));
+  while (!fPendingBlocks.empty() &&
+         fPendingBlocks.begin()->first == fNextSequence) {
+    auto next = std::move(fPendingBlocks.begin()->second);
+    fPendingBlocks.erase(fPendingBlocks.begin());
+    fNextSequence++;
+    if (next->GetNEvents() > 0) fQueue.Push(std::move(next));
+  }
+}
+
+void TEventWriter::Close()
+{
+  if (fIsClosed) return;
+  fIsClosed = true;
+
+  fQueue.Close();
+  fThread.join();
+
+  // The writer commits the last clusters and the footer when deleted
+  if (fNTuple) {
+    fNTuple.reset();
+    return;
+  }
+  fFile->cd();
+  fTree->Write();
+  fFile->Close();
+  delete fFile;
+  fFile = nullptr;
+}
+
+void TEventWriter::ResizeFlatColumns(std::size_t nHits)
+{
+  fBoard.resize(nHits);
+  fChannel.resize(nHits);
+  fDT.resize(nHits);
+  fEnergy.resize(nHits);
+  fEnergyShort.resize(nHits);
+  fTree->GetBranch("Board")->SetAddress(fBoard.data());
+  fTree->GetBranch("Channel")->SetAddress(fChannel.data());
+  fTree->GetBranch("dT")->SetAddress(fDT.data());
+  fTree->GetBranch("Energy")->SetAddress(fEnergy.data());
+  fTree->GetBranch("EnergyShort")->SetAddress(fEnergyShort.data());
+}
+
+void TEventWriter::WriteLoop()
+{
+  std::unique_ptr<TEventBlock> block;
+  while (fQueue.Pop(block)) {
+    const auto start = std::chrono::steady_clock::now();
+
+    // The output hits are made only here, right before the serialization
+    const auto &hits = block->Hits;
+    for (auto i = 0; i < block->GetNEvents(); i++) {
+      if (fLayout == EventLayout::RNTuple) {
+        FillNTuple(*block, i);
+        continue;
+      }
+      if (fLayout == EventLayout::HitRef) {
+        fFirstHit = block->HitIndex[i];
+        fNHits = block->NHits[i];
+        fTriggerIndex = block->TriggerIndex[i];
+      } else if (fLayout == EventLayout::Flat) {
+        const auto first = block->FirstHit[i];
+        fNHits = block->FirstHit[i + 1] - first;
+        if (fNHits > fDT.size()) ResizeFlatColumns(2 * fNHits);
+        for (auto k = 0; k < fNHits; k++) {
+          fBoard[k] = hits.Board[first + k];
+          fChannel[k] = hits.Channel[first + k];
+          fDT[k] = TicksToNs(hits.Timestamp[first + k]);
+          fEnergy[k] = hits.Energy[first + k];
+          fEnergyShort[k] = hits.EnergyShort[first + k];
+        }
+      } else {
+        fEvent->clear();
+        for (auto k = block->FirstHit[i]; k < block->FirstHit[i + 1]; k++) {
+          fEvent->emplace_back(hits.Board[k], hits.Channel[k],
+                               TicksToNs(hits.Timestamp[k]), hits.Energy[k],
+                               hits.EnergyShort[k]);
+        }
+      }
+      fTriggerID = block->TriggerID[i];
+      fTriggerTS = TicksToNs(block->TriggerTS[i]);
+      fMultiplicity = block->Multiplicity[i];
+      fGammaMultiplicity = block->GammaMultiplicity[i];
+      fEJMultiplicity = block->EJMultiplicity[i];
+      fGSMultiplicity = block->GSMultiplicity[i];
+      fIsFissionTrigger = block->IsFissionTrigger[i];
+      fTree->Fill();
+    }
+    block.reset();
+
+    fBusyTime += std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  }
+}
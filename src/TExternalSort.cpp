@@ -0,0 +1,158 @@
+#include "TExternalSort.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+TExternalSort::TExternalSort(std::string scratchDir, uint64_t memoryBudget,
+                             uint32_t nChunks)
+    : fScratchDir(scratchDir),
+      fMemoryBudget(memoryBudget),
+      fNChunks(std::max<uint32_t>(1, nChunks))
+{
+}
+
+TExternalSort::~TExternalSort()
+{
+  for (auto &run : fRuns) {
+    run->file.close();
+    std::remove(run->fileName.c_str());
+  }
+}
+
+bool TExternalSort::AddRun(const THitStore &hits)
+{
+  auto run = std::make_unique<Run_t>();
+  run->fileName = fScratchDir + "/hitRun_" + std::to_string(getpid()) + "_" +
+                  std::to_string(fRuns.size()) + ".bin";
+  run->nHits = hits.size();
+
+  std::ofstream fout(run->fileName, std::ios::binary);
+  if (!fout) {
+    std::cerr << "Cannot write " << run->fileName << std::endl;
+    return false;
+  }
+
+  // Packed records, written in blocks
+  constexpr uint64_t kBlockSize = 1 << 16;
+  std::vector<char> bytes(kBlockSize * kHitSize);
+  for (uint64_t first = 0; first < hits.size(); first += kBlockSize) {
+    const auto last = std::min<uint64_t>(first + kBlockSize, hits.size());
+    auto p = bytes.data();
+    for (auto i = first; i < last; i++) {
+      std::memcpy(p, &hits.Timestamp[i], 8);
+      std::memcpy(p + 8, &hits.Board[i], 1);
+      std::memcpy(p + 9, &hits.Channel[i], 1);
+      std::memcpy(p + 10, &hits.Energy[i], 2);
+      std::memcpy(p + 12, &hits.EnergyShort[i], 2);
+      p += kHitSize;
+    }
+    fout.write(bytes.data(), (last - first) * kHitSize);
+  }
+  fout.close();
+  if (!fout) {
+    std::cerr << "Failed to write " << run->fileName
+              << ".  Is the scratch disk full?" << std::endl;
+    std::remove(run->fileName.c_str());
+    return false;
+  }
+
+  fRuns.push_back(std::move(run));
+  return true;
+}
+
+uint64_t TExternalSort::GetChunkSize() const
+{
+  // Half of the budget for all the chunks in memory
+  return std::max<uint64_t>(1 << 10,
+                            fMemoryBudget / 2 / fNChunks / kStoreHitMemory);
+}
+
+uint64_t TExternalSort::GetBatchSize() const
+{
+  return std::max<uint64_t>(1, fMemoryBudget / kSortHitMemory);
+}
+
+void TExternalSort::StartMerge()
+{
+  // The rest for the read buffers: one store per run, and the bytes read
+  // before they are unpacked
+  const auto chunkMemory = fNChunks * GetChunkSize() * kStoreHitMemory;
+  const auto bufferMemory =
+      fMemoryBudget > chunkMemory ? fMemoryBudget - chunkMemory : 0;
+  const auto nBuffers = fRuns.size() + 1;
+  fBufferSize =
+      std::max<uint64_t>(1 << 10, bufferMemory / kHitSize / nBuffers);
+  fBytes.resize(fBufferSize * kHitSize);
+  const auto memory = chunkMemory + fBufferSize * kHitSize * nBuffers;
+  if (memory > fMemoryBudget) {
+    std::cerr << "Merging " << fRuns.size() << " runs needs "
+              << memory / 1024 / 1024 << " MB, more than the memory budget."
+              << std::endl;
+  }
+
+  fHeap.clear();
+  for (auto i = 0; i < fRuns.size(); i++) {
+    auto &run = *fRuns[i];
+    run.file.open(run.fileName, std::ios::binary);
+    run.nRead = 0;
+    if (FillBuffer(run)) fHeap.push_back(i);
+  }
+
+  auto comp = [this](const uint32_t a, const uint32_t b) {
+    return fRuns[a]->buffer.Timestamp[fRuns[a]->pos] >
+           fRuns[b]->buffer.Timestamp[fRuns[b]->pos];
+  };
+  std::make_heap(fHeap.begin(), fHeap.end(), comp);
+}
+
+bool TExternalSort::FillBuffer(Run_t &run)
+{
+  run.buffer.clear();
+  run.pos = 0;
+
+  const auto n = std::min(fBufferSize, run.nHits - run.nRead);
+  if (n == 0 || !run.file.read(fBytes.data(), n * kHitSize)) return false;
+  run.nRead += n;
+
+  run.buffer.resize(n);
+  auto p = fBytes.data();
+  for (uint64_t i = 0; i < n; i++) {
+    std::memcpy(&run.buffer.Timestamp[i], p, 8);
+    std::memcpy(&run.buffer.Board[i], p + 8, 1);
+    std::memcpy(&run.buffer.Channel[i], p + 9, 1);
+    std::memcpy(&run.buffer.Energy[i], p + 10, 2);
+    std::memcpy(&run.buffer.EnergyShort[i], p + 12, 2);
+    p += kHitSize;
+  }
+
+  return true;
+}
+
+std::unique_ptr<THitStore> TExternalSort::LoadNextHits(uint64_t nHits)
+{
+  auto hitVec = std::make_unique<THitStore>();
+  hitVec->reserve(nHits);
+
+  auto comp = [this](const uint32_t a, const uint32_t b) {
+    return fRuns[a]->buffer.Timestamp[fRuns[a]->pos] >
+           fRuns[b]->buffer.Timestamp[fRuns[b]->pos];
+  };
+
+  while (hitVec->size() < nHits && fHeap.size() > 0) {
+    std::pop_heap(fHeap.begin(), fHeap.end(), comp);
+    auto &run = *fRuns[fHeap.back()];
+    hitVec->PushBack(run.buffer, run.pos++);
+
+    if (run.pos >= run.buffer.size() && !FillBuffer(run)) {
+      fHeap.pop_back();
+    } else {
+      std::push_heap(fHeap.begin(), fHeap.end(), comp);
+    }
+  }
+
+  return hitVec;
+}
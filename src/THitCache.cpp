@@ -0,0 +1,173 @@
+#include "THitCache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+constexpr char THitCache::kMagic[8];
+
+THitCache::THitCache(std::string cacheDir,
+                     const std::vector<std::string> &fileList,
+                     HitFileType fileType,
+                     const ChSettingsVec_t &chSettingsVec, Double_t timeFrom,
+                     Double_t timeTo)
+{
+  // Everything the loaded hits depend on.  The range in ticks, the default
+  // float format would round it to 6 digits.
+  std::ostringstream key;
+  key << uint32_t(fileType) << "\n" << NsToTicks(timeFrom) << " "
+      << NsToTicks(timeTo) << "\n";
+  for (const auto &fileName : fileList) {
+    std::error_code err;
+    const auto size = std::filesystem::file_size(fileName, err);
+    const auto time = std::filesystem::last_write_time(fileName, err);
+    key << fileName << " " << size << " "
+        << time.time_since_epoch().count() << "\n";
+  }
+  for (const auto &mod : chSettingsVec) {
+    for (const auto &ch : mod) key << NsToTicks(ch.timeOffset) << " ";
+  }
+
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  for (const auto c : key.str()) {
+    hash = (hash ^ uint8_t(c)) * 1099511628211ull;
+  }
+
+  std::ostringstream fileName;
+  fileName << cacheDir << "/hitCache_" << std::hex << std::setw(16)
+           << std::setfill('0') << hash << ".bin";
+  fFileName = fileName.str();
+  fTmpFileName = fFileName + ".tmp" + std::to_string(getpid());
+}
+
+THitCache::~THitCache()
+{
+  if (fData) munmap(fData, fSize);
+  if (fFD >= 0) close(fFD);
+  if (fOut.is_open()) {
+    fOut.close();
+    std::remove(fTmpFileName.c_str());
+  }
+}
+
+std::size_t THitCache::GetBlockSize(uint64_t nHits)
+{
+  // nHits, then the columns.  Padded to 8 bytes for the next Timestamp.
+  const std::size_t size = 8 + nHits * (sizeof(Timestamp_t) + 1 + 1 + 2 + 2);
+  return (size + 7) / 8 * 8;
+}
+
+bool THitCache::Open()
+{
+  fFD = open(fFileName.c_str(), O_RDONLY);
+  if (fFD < 0) return false;
+
+  struct stat st;
+  if (fstat(fFD, &st) != 0 || st.st_size < sizeof(kMagic)) return false;
+  fSize = st.st_size;
+  auto data = mmap(nullptr, fSize, PROT_READ, MAP_PRIVATE, fFD, 0);
+  if (data == MAP_FAILED) return false;
+  fData = static_cast<char *>(data);
+  madvise(fData, fSize, MADV_SEQUENTIAL);
+
+  // Check all the block headers before the first block is used
+  if (std::memcmp(fData, kMagic, sizeof(kMagic)) != 0) return false;
+  std::size_t pos = sizeof(kMagic);
+  while (pos < fSize) {
+    uint64_t nHits;
+    if (pos + 8 > fSize) return false;
+    std::memcpy(&nHits, fData + pos, 8);
+    pos += GetBlockSize(nHits);
+  }
+  if (pos != fSize) {
+    std::cerr << "Broken hit cache " << fFileName << std::endl;
+    return false;
+  }
+
+  fPos = sizeof(kMagic);
+  return true;
+}
+
+std::unique_ptr<THitStore> THitCache::LoadNextHits()
+{
+  auto hitVec = std::make_unique<THitStore>();
+  if (!fData || fPos >= fSize) return hitVec;
+
+  uint64_t nHits;
+  std::memcpy(&nHits, fData + fPos, 8);
+  hitVec->resize(nHits);
+
+  auto p = fData + fPos + 8;
+  std::memcpy(hitVec->Timestamp.data(), p, nHits * sizeof(Timestamp_t));
+  p += nHits * sizeof(Timestamp_t);
+  std::memcpy(hitVec->Board.data(), p, nHits);
+  p += nHits;
+  std::memcpy(hitVec->Channel.data(), p, nHits);
+  p += nHits;
+  std::memcpy(hitVec->Energy.data(), p, nHits * 2);
+  p += nHits * 2;
+  std::memcpy(hitVec->EnergyShort.data(), p, nHits * 2);
+
+  fPos += GetBlockSize(nHits);
+  return hitVec;
+}
+
+bool THitCache::Create()
+{
+  fOut.open(fTmpFileName, std::ios::binary);
+  if (!fOut) {
+    std::cerr << "Cannot write the hit cache " << fTmpFileName << std::endl;
+    return false;
+  }
+  fOut.write(kMagic, sizeof(kMagic));
+  fIsWriteOK = bool(fOut);
+
+  return fIsWriteOK;
+}
+
+bool THitCache::Write(const THitStore &hits)
+{
+  if (!fIsWriteOK) return false;
+
+  const uint64_t nHits = hits.size();
+  fOut.write(reinterpret_cast<const char *>(&nHits), 8);
+  fOut.write(reinterpret_cast<const char *>(hits.Timestamp.data()),
+             nHits * sizeof(Timestamp_t));
+  fOut.write(reinterpret_cast<const char *>(hits.Board.data()), nHits);
+  fOut.write(reinterpret_cast<const char *>(hits.Channel.data()), nHits);
+  fOut.write(reinterpret_cast<const char *>(hits.Energy.data()), nHits * 2);
+  fOut.write(reinterpret_cast<const char *>(hits.EnergyShort.data()),
+             nHits * 2);
+  const char padding[8] = {};
+  fOut.write(padding, GetBlockSize(nHits) - 8 - nHits * 14);
+
+  fIsWriteOK = bool(fOut);
+  if (!fIsWriteOK) {
+    std::cerr << "Failed to write the hit cache " << fTmpFileName
+              << std::endl;
+  }
+  return fIsWriteOK;
+}
+
+bool THitCache::Commit()
+{
+  if (!fOut.is_open()) return false;
+  fOut.close();
+  if (!fIsWriteOK || !fOut ||
+      std::rename(fTmpFileName.c_str(), fFileName.c_str()) != 0) {
+    std::remove(fTmpFileName.c_str());
+    return false;
+  }
+
+  std::cout << "Hit cache written: " << fFileName << std::endl;
+  return true;
+}
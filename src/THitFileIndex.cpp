@@ -0,0 +1,153 @@
+#include "THitFileIndex.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <nlohmann/json.hpp>
+
+THitFileIndex::THitFileIndex(std::string fileName, HitFileType fileType)
+    : fFileName(fileName), fFileType(fileType)
+{
+}
+
+std::string THitFileIndex::GetIndexName(const std::string &fileName)
+{
+  return fileName + ".idx.json";
+}
+
+bool THitFileIndex::ReadFileStatus(uint64_t &size, int64_t &time) const
+{
+  std::error_code err;
+  size = std::filesystem::file_size(fFileName, err);
+  if (err) return false;
+  time = std::filesystem::last_write_time(fFileName, err)
+             .time_since_epoch()
+             .count();
+  return !err;
+}
+
+bool THitFileIndex::Load()
+{
+  std::ifstream fin(GetIndexName(fFileName));
+  if (!fin) return false;
+
+  uint64_t size;
+  int64_t time;
+  if (!ReadFileStatus(size, time)) return false;
+
+  try {
+    nlohmann::json index;
+    fin >> index;
+    if (index["Version"].get<uint32_t>() != kVersion ||
+        index["FileType"].get<uint32_t>() != uint32_t(fFileType) ||
+        index["FileSize"].get<uint64_t>() != size ||
+        index["FileTime"].get<int64_t>() != time) {
+      return false;
+    }
+
+    fFileSize = size;
+    fFileTime = time;
+    fTreeName = index["TreeName"].get<std::string>();
+    fNEntries = index["Entries"].get<Long64_t>();
+    fNHits = index["Hits"].get<uint64_t>();
+
+    fClusters.clear();
+    for (const auto &cluster : index["Clusters"]) {
+      fClusters.emplace_back(cluster[0].get<Long64_t>(),
+                             cluster[1].get<Long64_t>());
+    }
+
+    fBoards.clear();
+    for (const auto &brd : index["Boards"]) {
+      BoardIndex_t boardIndex;
+      boardIndex.board = brd["Board"].get<uint32_t>();
+      boardIndex.minTS = brd["MinTS"].get<Timestamp_t>();
+      boardIndex.maxTS = brd["MaxTS"].get<Timestamp_t>();
+      boardIndex.nHits = brd["Hits"].get<std::vector<uint64_t>>();
+      fBoards.push_back(boardIndex);
+    }
+  } catch (const nlohmann::json::exception &e) {
+    std::cerr << "Broken index " << GetIndexName(fFileName) << ": "
+              << e.what() << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool THitFileIndex::Save() const
+{
+  nlohmann::json index;
+  index["Version"] = kVersion;
+  index["FileType"] = uint32_t(fFileType);
+  index["FileSize"] = fFileSize;
+  index["FileTime"] = fFileTime;
+  index["TreeName"] = fTreeName;
+  index["Entries"] = fNEntries;
+  index["Hits"] = fNHits;
+
+  index["Clusters"] = nlohmann::json::array();
+  for (const auto &cluster : fClusters) {
+    index["Clusters"].push_back({cluster.first, cluster.second});
+  }
+
+  index["Boards"] = nlohmann::json::array();
+  for (const auto &boardIndex : fBoards) {
+    nlohmann::json brd;
+    brd["Board"] = boardIndex.board;
+    brd["MinTS"] = boardIndex.minTS;
+    brd["MaxTS"] = boardIndex.maxTS;
+    brd["Hits"] = boardIndex.nHits;
+    index["Boards"].push_back(brd);
+  }
+
+  std::ofstream fout(GetIndexName(fFileName));
+  if (!fout) return false;
+  fout << index.dump(2) << std::endl;
+
+  return bool(fout);
+}
+
+void THitFileIndex::SetTree(const THitReader &reader)
+{
+  ReadFileStatus(fFileSize, fFileTime);
+  fTreeName = reader.GetTreeName();
+  fNEntries = reader.GetEntries();
+  fClusters = reader.GetClusters();
+}
+
+void THitFileIndex::SetHits(const std::vector<const THitStore *> &hitsVec,
+                            const ChSettingsVec_t &chSettingsVec)
+{
+  std::map<uint32_t, BoardIndex_t> boards;
+  fNHits = 0;
+  for (const auto hits : hitsVec) {
+    fNHits += hits->size();
+    for (std::size_t i = 0; i < hits->size(); i++) {
+      const auto brd = hits->Board[i];
+      const auto ch = hits->Channel[i];
+      const auto ts = hits->Timestamp[i] -
+                      NsToTicks(chSettingsVec.at(brd).at(ch).timeOffset);
+
+      auto it = boards.find(brd);
+      if (it == boards.end()) {
+        BoardIndex_t boardIndex;
+        boardIndex.board = brd;
+        boardIndex.minTS = ts;
+        boardIndex.maxTS = ts;
+        it = boards.emplace(brd, boardIndex).first;
+      }
+      auto &boardIndex = it->second;
+      boardIndex.minTS = std::min(boardIndex.minTS, ts);
+      boardIndex.maxTS = std::max(boardIndex.maxTS, ts);
+      if (boardIndex.nHits.size() <= ch) boardIndex.nHits.resize(ch + 1, 0);
+      boardIndex.nHits[ch]++;
+    }
+  }
+
+  fBoards.clear();
+  for (const auto &brd : boards) fBoards.push_back(brd.second);
+}
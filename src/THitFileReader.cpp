@@ -0,0 +1,293 @@
+#include "THitFileReader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// Raw timestamps are in ps, fixed or floating point
+static inline Timestamp_t RawToTicks(Double_t ts) { return std::llround(ts); }
+static inline Timestamp_t RawToTicks(ULong64_t ts) { return Timestamp_t(ts); }
+
+THitFileReader::THitFileReader(std::string fileName, HitFileType fileType,
+                               const ChSettingsVec_t &chSettingsVec)
+    : THitReader(fileName, chSettingsVec), fFileType(fileType)
+{
+  fFile = TFile::Open(fileName.c_str(), "READ");
+  if (!fFile) {
+    std::cerr << "File not found: " << fileName << std::endl;
+    return;
+  }
+
+  switch (fFileType) {
+    case HitFileType::DELILA:
+      SetDELILABranches();
+      break;
+    case HitFileType::ELIGANT:
+      SetELIGANTBranches();
+      break;
+    default:
+      std::cerr << "Unknown file type" << std::endl;
+      break;
+  }
+  if (!fTree) {
+    std::cerr << "No hit tree found in " << fileName << std::endl;
+    return;
+  }
+
+  fNEntries = fTree->GetEntries();
+  SetBulkRead();
+}
+
+THitFileReader::~THitFileReader()
+{
+  if (fFile) {
+    fFile->Close();
+    delete fFile;
+  }
+}
+
+void THitFileReader::SetDELILABranches()
+{
+  fTree = dynamic_cast<TTree *>(fFile->Get("ELIADE_Tree"));
+  if (!fTree) return;
+
+  fTree->SetBranchStatus("*", kFALSE);
+  fTree->SetBranchStatus("Mod", kTRUE);
+  fTree->SetBranchAddress("Mod", &fDELILABrd);
+  fTree->SetBranchStatus("Ch", kTRUE);
+  fTree->SetBranchAddress("Ch", &fDELILACh);
+  fTree->SetBranchStatus("ChargeLong", kTRUE);
+  fTree->SetBranchAddress("ChargeLong", &fEne);
+  fTree->SetBranchStatus("ChargeShort", kTRUE);
+  fTree->SetBranchAddress("ChargeShort", &fEneShort);
+  fTree->SetBranchStatus("FineTS", kTRUE);
+  fTree->SetBranchAddress("FineTS", &fDELILATS);
+
+  fBrdBranch = fTree->GetBranch("Mod");
+  fChBranch = fTree->GetBranch("Ch");
+  fEneBranch = fTree->GetBranch("ChargeLong");
+  fEneShortBranch = fTree->GetBranch("ChargeShort");
+  fTSBranch = fTree->GetBranch("FineTS");
+}
+
+void THitFileReader::SetELIGANTBranches()
+{
+  fTree = dynamic_cast<TTree *>(fFile->Get("tout"));
+  if (!fTree) return;
+
+  fTree->SetBranchStatus("*", kFALSE);
+  fTree->SetBranchStatus("Board", kTRUE);
+  fTree->SetBranchAddress("Board", &fELIGANTBrd);
+  fTree->SetBranchStatus("Channel", kTRUE);
+  fTree->SetBranchAddress("Channel", &fELIGANTCh);
+  fTree->SetBranchStatus("Energy", kTRUE);
+  fTree->SetBranchAddress("Energy", &fEne);
+  fTree->SetBranchStatus("EnergyShort", kTRUE);
+  fTree->SetBranchAddress("EnergyShort", &fEneShort);
+  fTree->SetBranchStatus("Timestamp", kTRUE);
+  fTree->SetBranchAddress("Timestamp", &fELIGANTTS);
+  fTree->SetBranchStatus("Flags", kTRUE);
+  fTree->SetBranchAddress("Flags", &fELIGANTFlag);
+
+  fBrdBranch = fTree->GetBranch("Board");
+  fChBranch = fTree->GetBranch("Channel");
+  fEneBranch = fTree->GetBranch("Energy");
+  fEneShortBranch = fTree->GetBranch("EnergyShort");
+  fTSBranch = fTree->GetBranch("Timestamp");
+  fFlagBranch = fTree->GetBranch("Flags");
+}
+
+void THitFileReader::SetBulkRead()
+{
+  std::vector<TBranch *> branches = {fBrdBranch, fChBranch, fEneBranch,
+                                     fEneShortBranch, fTSBranch};
+  if (fFileType == HitFileType::ELIGANT) branches.push_back(fFlagBranch);
+
+  fUseBulkRead = true;
+  for (auto branch : branches) {
+    if (!branch || !branch->GetBulkRead().SupportsBulkRead()) {
+      fUseBulkRead = false;
+      break;
+    }
+  }
+}
+
+std::vector<EntryRange_t> THitFileReader::GetClusters() const
+{
+  std::vector<EntryRange_t> clusters;
+  if (!fTree) return clusters;
+
+  auto clusterIter = fTree->GetClusterIterator(0);
+  Long64_t start;
+  while ((start = clusterIter.Next()) < fNEntries) {
+    clusters.emplace_back(start,
+                          std::min(clusterIter.GetNextEntry(), fNEntries));
+  }
+
+  return clusters;
+}
+
+Double_t THitFileReader::GetRawTS(Long64_t entry)
+{
+  if (fTSBranch) {
+    fTSBranch->GetEntry(entry);
+  } else {
+    fTree->GetEntry(entry);
+  }
+  if (fFileType == HitFileType::DELILA) return fDELILATS / 1000.;
+  return Double_t(fELIGANTTS) / 1000.;
+}
+
+void THitFileReader::Read(Long64_t first, Long64_t last, THitStore &hits)
+{
+  if (!fTree) return;
+  last = std::min(last, fNEntries);
+  if (first >= last) return;
+
+  if (fUseBulkRead) {
+    auto isRead = (fFileType == HitFileType::DELILA)
+                      ? ReadDELILABulk(first, last, hits)
+                      : ReadELIGANTBulk(first, last, hits);
+    if (isRead) return;
+
+    std::cerr << "Bulk read failed, reading entry by entry: " << fFileName
+              << std::endl;
+    fUseBulkRead = false;
+  }
+
+  ReadEntries(first, last, hits);
+}
+
+void THitFileReader::ReadEntries(Long64_t first, Long64_t last,
+                                 THitStore &hits)
+{
+  for (auto i = first; i < last; i++) {
+    fTree->GetEntry(i);
+    if (fFileType == HitFileType::DELILA) {
+      const auto &chSetting = fChSettingsVec.at(fDELILABrd).at(fDELILACh);
+      auto fineTS = RawToTicks(fDELILATS) + NsToTicks(chSetting.timeOffset);
+      hits.emplace_back(fDELILABrd, fDELILACh, fineTS, fEne, fEneShort);
+    } else {
+      if (fELIGANTFlag == 0) continue;
+      const auto &chSetting = fChSettingsVec.at(fELIGANTBrd).at(fELIGANTCh);
+      auto fineTS = RawToTicks(fELIGANTTS) + NsToTicks(chSetting.timeOffset);
+      hits.emplace_back(fELIGANTBrd, fELIGANTCh, fineTS, fEne, fEneShort);
+    }
+  }
+}
+
+template <typename T>
+bool THitFileReader::ReadColumn(TBranch *branch, Long64_t first,
+                                Long64_t last, std::vector<T> &column)
+{
+  column.resize(last - first);
+
+  // A bulk read returns a whole basket and has to start at its first entry
+  auto basketEntry = branch->GetBasketEntry();
+  auto nBaskets = branch->GetWriteBasket() + 1;
+  auto entry =
+      *(std::upper_bound(basketEntry, basketEntry + nBaskets, first) - 1);
+
+  while (entry < last) {
+    auto n = branch->GetBulkRead().GetBulkEntries(entry, fBulkBuffer);
+    if (n <= 0) return false;
+
+    auto begin = std::max(entry, first);
+    auto end = std::min(entry + n, last);
+    std::memcpy(column.data() + (begin - first),
+                fBulkBuffer.GetCurrent() + (begin - entry) * sizeof(T),
+                (end - begin) * sizeof(T));
+    entry += n;
+  }
+
+  return true;
+}
+
+template <typename ID_t, typename TS_t>
+void THitFileReader::AppendColumns(const std::vector<ID_t> &brd,
+                                   const std::vector<ID_t> &ch,
+                                   const std::vector<TS_t> &ts,
+                                   std::size_t n, THitStore &hits)
+{
+  // Same check as at() of the entry by entry path
+  fIndexCol.resize(n);
+  auto isInRange = true;
+  for (std::size_t i = 0; i < n; i++) {
+    isInRange &= (brd[i] < fNBoards) & (ch[i] < fNChs);
+    fIndexCol[i] = brd[i] * fNChs + ch[i];
+  }
+  if (isInRange) {
+    for (std::size_t i = 0; i < n; i++) {
+      isInRange &= IsKnownCh(brd[i], ch[i]);
+    }
+  }
+  if (!isInRange) {
+    throw std::out_of_range("Hit of a channel not in the settings: " +
+                            fFileName);
+  }
+
+  auto offset = hits.size();
+  hits.resize(offset + n);
+  auto hitBrd = hits.Board.data() + offset;
+  auto hitCh = hits.Channel.data() + offset;
+  auto hitTS = hits.Timestamp.data() + offset;
+  for (std::size_t i = 0; i < n; i++) hitBrd[i] = brd[i];
+  for (std::size_t i = 0; i < n; i++) hitCh[i] = ch[i];
+  for (std::size_t i = 0; i < n; i++) {
+    hitTS[i] = RawToTicks(ts[i]) + fTimeOffset[fIndexCol[i]];
+  }
+  std::memcpy(hits.Energy.data() + offset, fEneCol.data(),
+              n * sizeof(UShort_t));
+  std::memcpy(hits.EnergyShort.data() + offset, fEneShortCol.data(),
+              n * sizeof(UShort_t));
+}
+
+bool THitFileReader::ReadDELILABulk(Long64_t first, Long64_t last,
+                                    THitStore &hits)
+{
+  if (!ReadColumn(fBrdBranch, first, last, fDELILABrdCol) ||
+      !ReadColumn(fChBranch, first, last, fDELILAChCol) ||
+      !ReadColumn(fEneBranch, first, last, fEneCol) ||
+      !ReadColumn(fEneShortBranch, first, last, fEneShortCol) ||
+      !ReadColumn(fTSBranch, first, last, fDELILATSCol)) {
+    return false;
+  }
+
+  AppendColumns(fDELILABrdCol, fDELILAChCol, fDELILATSCol, last - first,
+                hits);
+  return true;
+}
+
+bool THitFileReader::ReadELIGANTBulk(Long64_t first, Long64_t last,
+                                     THitStore &hits)
+{
+  if (!ReadColumn(fBrdBranch, first, last, fELIGANTBrdCol) ||
+      !ReadColumn(fChBranch, first, last, fELIGANTChCol) ||
+      !ReadColumn(fEneBranch, first, last, fEneCol) ||
+      !ReadColumn(fEneShortBranch, first, last, fEneShortCol) ||
+      !ReadColumn(fTSBranch, first, last, fELIGANTTSCol) ||
+      !ReadColumn(fFlagBranch, first, last, fELIGANTFlagCol)) {
+    return false;
+  }
+
+  // Flags == 0 are dropped.  Usually none, then the columns are used as is.
+  std::size_t n = last - first;
+  std::size_t nValid = 0;
+  for (std::size_t i = 0; i < n; i++) nValid += (fELIGANTFlagCol[i] != 0);
+  if (nValid < n) {
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < n; i++) {
+      if (fELIGANTFlagCol[i] == 0) continue;
+      fELIGANTBrdCol[j] = fELIGANTBrdCol[i];
+      fELIGANTChCol[j] = fELIGANTChCol[i];
+      fEneCol[j] = fEneCol[i];
+      fEneShortCol[j] = fEneShortCol[i];
+      fELIGANTTSCol[j] = fELIGANTTSCol[i];
+      j++;
+    }
+  }
+
+  AppendColumns(fELIGANTBrdCol, fELIGANTChCol, fELIGANTTSCol, nValid, hits);
+  return true;
+}
@@ -1,219 +1,368 @@
 #include "THitLoader.hpp"
 
-#include <TFile.h>
-#include <TKey.h>
 #include <TROOT.h>
-#include <TTree.h>
-#include <unistd.h>
 
-#include <execution>
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <limits>
 #include <mutex>
-#include <parallel/algorithm>
 #include <thread>
 
-std::unique_ptr<std::vector<HitData_t>> THitLoader::LoadHitsMT(
+std::unique_ptr<THitStore> THitLoader::LoadHitsMT(
     std::vector<std::string> fileList, uint32_t nThreads, HitFileType fileType)
 {
-  fHitVec = std::make_unique<std::vector<HitData_t>>();
-  auto nHits = 0;
-  for (auto &fileName : fileList) {
-    auto file = new TFile(fileName.c_str(), "READ");
-    TIter nextkey(file->GetListOfKeys());
-    while (auto key = (TKey *)nextkey()) {
-      TObject *obj = key->ReadObj();
-      if (obj->IsA()->InheritsFrom(TTree::Class())) {
-        auto tree = (TTree *)obj;
-        nHits += tree->GetEntries();
-        file->Close();
-        delete file;
-        break;
+  ROOT::EnableThreadSafety();
+  if (nThreads == 0) nThreads = 1;
+
+  // Entry clusters (basket boundaries) of every file.  They come from the
+  // index of the file when it is up to date.  Otherwise the file is opened,
+  // and a new index is made from the hits read below.
+  std::vector<std::unique_ptr<THitFileIndex>> indexes(fileList.size());
+  // With a time range, the edge files are searched for the entries in it.
+  std::vector<UChar_t> isNewIndex(fileList.size(), 0);
+  std::vector<EntryRange_t> entryRanges(
+      fileList.size(), {0, std::numeric_limits<Long64_t>::max()});
+  const auto rawFrom = fTimeFrom - *std::max_element(fMaxTimeOffset.begin(),
+                                                     fMaxTimeOffset.end());
+  const auto rawTo = fTimeTo - *std::min_element(fMinTimeOffset.begin(),
+                                                 fMinTimeOffset.end());
+  std::atomic<uint32_t> next(0);
+  auto getClusters = [&]() {
+    for (uint32_t i = next++; i < fileList.size(); i = next++) {
+      indexes[i] = std::make_unique<THitFileIndex>(fileList[i], fileType);
+      if (indexes[i]->Load()) {
+        if (!fHasTimeRange || !IsInTimeRange(*indexes[i])) continue;
+        const auto timeRange = GetTimeRange(*indexes[i]);
+        if (timeRange.first >= fTimeFrom && timeRange.second <= fTimeTo) {
+          continue;
+        }
+        auto reader = THitReader::Open(fileList[i], fileType, fChSettingsVec);
+        entryRanges[i] =
+            reader->FindEntryRange(rawFrom, rawTo, indexes[i]->GetClusters());
+        continue;
       }
-    }
-  }
-  fHitVec->reserve(nHits);
 
-  while (true) {
-    if (fileList.size() == 0) {
-      break;
+      auto reader = THitReader::Open(fileList[i], fileType, fChSettingsVec);
+      if (!reader->IsOpen()) {
+        indexes[i].reset();
+        continue;
+      }
+      indexes[i]->SetTree(*reader);
+      isNewIndex[i] = 1;
     }
+  };
+  RunThreads(getClusters, std::min<uint32_t>(nThreads, fileList.size()));
 
-    fInsertFlags.clear();
-    for (auto i = 0; i < nThreads; i++) {
-      fInsertFlags.push_back(false);
+  std::vector<std::vector<EntryRange_t>> clusters(fileList.size());
+  for (auto i = 0; i < fileList.size(); i++) {
+    if (!indexes[i]) continue;
+    if (!isNewIndex[i] && indexes[i]->GetNHits() == 0) {
+      std::cout << "Skipping " << fileList[i] << ", no hits" << std::endl;
+      continue;
+    }
+    if (!isNewIndex[i] && fHasTimeRange && !IsInTimeRange(*indexes[i])) {
+      continue;
+    }
+    for (const auto &cluster : indexes[i]->GetClusters()) {
+      if (cluster.first >= entryRanges[i].first &&
+          cluster.second <= entryRanges[i].second) {
+        clusters[i].push_back(cluster);
+      }
     }
-    fInsertFlags[0] = true;
+  }
 
-    std::vector<std::string> threadFileList;
-    for (auto i = 0; i < nThreads; i++) {
-      if (fileList.size() == 0) {
-        break;
+  // Tasks of consecutive clusters of one file.  A few tasks per thread, so
+  // the few big files at the end of a run are also shared by all threads.
+  Long64_t nEntries = 0;
+  for (const auto &fileClusters : clusters) {
+    for (const auto &cluster : fileClusters) {
+      nEntries += cluster.second - cluster.first;
+    }
+  }
+  const Long64_t taskSize =
+      std::max<Long64_t>(1, nEntries / (nThreads * kTasksPerThread));
+  std::vector<LoadTask_t> tasks;
+  for (auto i = 0; i < clusters.size(); i++) {
+    for (const auto &cluster : clusters[i]) {
+      if (tasks.size() > 0 && tasks.back().fileIndex == i &&
+          tasks.back().last - tasks.back().first < taskSize) {
+        tasks.back().last = cluster.second;
+      } else {
+        tasks.push_back({uint32_t(i), cluster.first, cluster.second});
       }
-      threadFileList.push_back(fileList.front());
-      fileList.erase(fileList.begin());
     }
+  }
 
-    std::vector<std::thread> threads;
-    for (auto i = 0; i < threadFileList.size(); i++) {
-      threads.emplace_back([this, i, threadFileList, fileType]() {
-        switch (fileType) {
-          case HitFileType::DELILA:
-            LoadDELILAHits(threadFileList[i], i);
-            break;
-          case HitFileType::ELIGANT:
-            LoadELIGANTHits(threadFileList[i], i);
-            break;
-          default:
-            std::cerr << "Unknown file type" << std::endl;
-            break;
+  // Each worker takes the next task as soon as it is free.  It keeps the
+  // file open while its tasks come from the same file.
+  std::vector<THitStore> taskHits(tasks.size());
+  next = 0;
+  auto readTasks = [&]() {
+    std::unique_ptr<THitReader> reader;
+    uint32_t fileIndex = 0;
+    for (uint32_t i = next++; i < tasks.size(); i = next++) {
+      const auto &task = tasks[i];
+      if (!reader || fileIndex != task.fileIndex) {
+        fileIndex = task.fileIndex;
+        {
+          std::lock_guard<std::mutex> lock(fFileListMutex);
+          std::cout << "Loading hits from " << fileList[fileIndex]
+                    << std::endl;
         }
-      });
-
-      usleep(100000);
+        reader =
+            THitReader::Open(fileList[fileIndex], fileType, fChSettingsVec);
+      }
+      taskHits[i].reserve(task.last - task.first);
+      reader->Read(task.first, task.last, taskHits[i]);
     }
+  };
+  RunThreads(readTasks, std::min<uint32_t>(nThreads, tasks.size()));
 
-    for (auto &thread : threads) {
-      thread.join();
+  // Index of the files read for the first time
+  std::vector<std::vector<const THitStore *>> fileHits(fileList.size());
+  for (auto i = 0; i < tasks.size(); i++) {
+    fileHits[tasks[i].fileIndex].push_back(&taskHits[i]);
+  }
+  std::atomic<uint32_t> nSaveErrors(0);
+  next = 0;
+  auto makeIndexes = [&]() {
+    for (uint32_t i = next++; i < fileList.size(); i = next++) {
+      if (!isNewIndex[i]) continue;
+      indexes[i]->SetHits(fileHits[i], fChSettingsVec);
+      if (!indexes[i]->Save()) nSaveErrors++;
     }
+  };
+  RunThreads(makeIndexes, std::min<uint32_t>(nThreads, fileList.size()));
+  if (nSaveErrors > 0) {
+    std::cerr << "Failed to write the index of " << nSaveErrors
+              << " files.  They are opened twice again next time."
+              << std::endl;
   }
 
+  // Stitch the tasks in file and entry order.  Presize once, and copy each
+  // buffer into its own offset range.
+  std::vector<uint64_t> offsets(taskHits.size() + 1, 0);
+  for (auto i = 0; i < taskHits.size(); i++) {
+    offsets[i + 1] = offsets[i] + taskHits[i].size();
+  }
+  fHitVec = std::make_unique<THitStore>();
+  fHitVec->resize(offsets.back());
+
+  next = 0;
+  auto copyTasks = [&]() {
+    for (uint32_t i = next++; i < taskHits.size(); i = next++) {
+      fHitVec->CopyAt(offsets[i], taskHits[i]);
+      taskHits[i] = THitStore();
+    }
+  };
+  RunThreads(copyTasks, std::min<uint32_t>(nThreads, taskHits.size()));
+
   std::cout << "Sorting hits" << std::endl;
-  __gnu_parallel::sort(fHitVec->begin(), fHitVec->end(),
-                       [](const HitData_t &a, const HitData_t &b) {
-                         return std::get<2>(a) < std::get<2>(b);
-                       });
-  // std::sort(std::execution::par, fHitVec->begin(), fHitVec->end(),
-  //           [](const HitData_t &a, const HitData_t &b) {
-  //             return std::get<2>(a) < std::get<2>(b);
-  //           });
+  fHitVec->SortByTime(nThreads);
 
   return std::move(fHitVec);
 }
 
-void THitLoader::LoadDELILAHits(std::string fileName, uint32_t threadID)
+std::vector<uint64_t> THitLoader::CountHits(
+    const std::vector<std::string> &fileList, uint32_t nThreads,
+    HitFileType fileType)
 {
   ROOT::EnableThreadSafety();
-  {
-    std::lock_guard<std::mutex> lock(fFileListMutex);
-    std::cout << "Loading hits from " << fileName << std::endl;
-  }
-  auto file = TFile::Open(fileName.c_str(), "READ");
-  if (!file) {
-    std::cerr << "File not found: " << fileName << std::endl;
-    return;
-  }
-  auto tree = dynamic_cast<TTree *>(file->Get("ELIADE_Tree"));
+  if (nThreads == 0) nThreads = 1;
 
-  tree->SetBranchStatus("*", kFALSE);
-  UChar_t brd;
-  tree->SetBranchStatus("Mod", kTRUE);
-  tree->SetBranchAddress("Mod", &brd);
-  UChar_t ch;
-  tree->SetBranchStatus("Ch", kTRUE);
-  tree->SetBranchAddress("Ch", &ch);
+  std::vector<uint64_t> nHits(fileList.size(), 0);
+  std::atomic<uint32_t> next(0);
+  auto countHits = [&]() {
+    for (uint32_t i = next++; i < fileList.size(); i = next++) {
+      THitFileIndex index(fileList[i], fileType);
+      if (index.Load()) {
+        nHits[i] = index.GetNHits();
+        continue;
+      }
+      auto reader = THitReader::Open(fileList[i], fileType, fChSettingsVec);
+      if (reader->IsOpen()) nHits[i] = reader->GetEntries();
+    }
+  };
+  RunThreads(countHits, std::min<uint32_t>(nThreads, fileList.size()));
 
-  UShort_t ene;
-  tree->SetBranchStatus("ChargeLong", kTRUE);
-  tree->SetBranchAddress("ChargeLong", &ene);
+  return nHits;
+}
 
-  UShort_t eneShort;
-  tree->SetBranchStatus("ChargeShort", kTRUE);
-  tree->SetBranchAddress("ChargeShort", &eneShort);
+void THitLoader::RunThreads(std::function<void()> func, uint32_t nThreads)
+{
+  std::vector<std::thread> threads;
+  for (auto i = 0; i < nThreads; i++) {
+    threads.emplace_back(func);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
 
-  Double_t ts;
-  tree->SetBranchStatus("FineTS", kTRUE);
-  tree->SetBranchAddress("FineTS", &ts);
+void THitLoader::SetTimeRange(Double_t from, Double_t to)
+{
+  fTimeFrom = from;
+  fTimeTo = to;
+  fHasTimeRange = true;
+}
 
-  auto hitsVec = std::vector<HitData_t>();
-  hitsVec.reserve(tree->GetEntries());
-  for (auto i = 0; i < tree->GetEntries(); i++) {
-    tree->GetEntry(i);
-    auto fineTS = ts / 1000. + fChSettingsVec.at(brd).at(ch).timeOffset;
+void THitLoader::SetTimeOffsetRange()
+{
+  fMinTimeOffset.clear();
+  fMaxTimeOffset.clear();
+  for (const auto &mod : fChSettingsVec) {
+    Double_t minOffset = 0.;
+    Double_t maxOffset = 0.;
+    for (auto i = 0; i < mod.size(); i++) {
+      const auto offset = mod[i].timeOffset;
+      minOffset = (i == 0) ? offset : std::min(minOffset, offset);
+      maxOffset = (i == 0) ? offset : std::max(maxOffset, offset);
+    }
+    fMinTimeOffset.push_back(minOffset);
+    fMaxTimeOffset.push_back(maxOffset);
+  }
+  if (fMinTimeOffset.empty()) {
+    fMinTimeOffset.push_back(0.);
+    fMaxTimeOffset.push_back(0.);
+  }
+}
 
-    hitsVec.emplace_back(brd, ch, fineTS, ene, eneShort);
+std::vector<std::string> THitLoader::SelectFiles(
+    const std::vector<std::string> &fileList, HitFileType fileType)
+{
+  if (!fHasTimeRange) return fileList;
 
-    // std::cout << "brd: " << brd << " ch: " << ch << " ts: " << fineTS
-    //           << " ene: " << ene << " eneShort: " << eneShort << std::endl;
+  std::vector<std::string> selected;
+  for (const auto &fileName : fileList) {
+    THitFileIndex index(fileName, fileType);
+    if (index.Load() && !IsInTimeRange(index)) continue;
+    selected.push_back(fileName);
   }
+  std::cout << selected.size() << " of " << fileList.size()
+            << " files in the time range" << std::endl;
+
+  return selected;
+}
 
-  file->Close();
-  while (true) {
-    if (fInsertFlags[threadID]) {
-      break;
+std::pair<Double_t, Double_t> THitLoader::GetTimeRange(
+    const THitFileIndex &index) const
+{
+  auto first = std::numeric_limits<Double_t>::max();
+  auto last = std::numeric_limits<Double_t>::lowest();
+  for (const auto &brd : index.GetBoards()) {
+    Double_t minOffset = 0.;
+    Double_t maxOffset = 0.;
+    if (brd.board < fMinTimeOffset.size()) {
+      minOffset = fMinTimeOffset[brd.board];
+      maxOffset = fMaxTimeOffset[brd.board];
     }
-    usleep(1000);
+    first = std::min(first, TicksToNs(brd.minTS) + minOffset);
+    last = std::max(last, TicksToNs(brd.maxTS) + maxOffset);
   }
-  {
-    std::lock_guard<std::mutex> lock(fHitVecMutex);
-    fHitVec->insert(fHitVec->end(), hitsVec.begin(), hitsVec.end());
-    if (threadID + 1 < fInsertFlags.size()) fInsertFlags[threadID + 1] = true;
-    std::cout << "Finished: " << fileName << std::endl;
-  }
-  hitsVec.clear();
+
+  return std::make_pair(first, last);
+}
+
+bool THitLoader::IsInTimeRange(const THitFileIndex &index) const
+{
+  const auto timeRange = GetTimeRange(index);
+  return timeRange.first <= fTimeTo && timeRange.second >= fTimeFrom;
 }
 
-void THitLoader::LoadELIGANTHits(std::string fileName, uint32_t threadID)
+void THitLoader::OpenStream(std::vector<std::string> fileList,
+                            HitFileType fileType, uint32_t nOpenFiles,
+                            uint32_t chunkSize)
 {
   ROOT::EnableThreadSafety();
-  {
-    std::lock_guard<std::mutex> lock(fFileListMutex);
+
+  fStreamFileList = fileList;
+  fStreamFileType = fileType;
+  fStreamChunkSize = chunkSize;
+  fLastStreamTS = kMinTimestamp;
+  fNLateHits = 0;
+
+  fStreams.clear();
+  fStreamHeap.clear();
+  if (nOpenFiles == 0) nOpenFiles = 1;
+  for (auto i = 0; i < nOpenFiles; i++) {
+    fStreams.emplace_back(nullptr);
+    if (OpenNextStream(i)) fStreamHeap.push_back(i);
+  }
+
+  auto comp = [this](const uint32_t a, const uint32_t b) {
+    return fStreams[a]->FrontTS() > fStreams[b]->FrontTS();
+  };
+  std::make_heap(fStreamHeap.begin(), fStreamHeap.end(), comp);
+}
+
+bool THitLoader::OpenNextStream(uint32_t slot)
+{
+  fStreams[slot].reset();
+  while (fStreamFileList.size() > 0) {
+    auto fileName = fStreamFileList.front();
+    fStreamFileList.erase(fStreamFileList.begin());
+    THitFileIndex index(fileName, fStreamFileType);
+    if (index.Load() && index.GetNHits() == 0) {
+      std::cout << "Skipping " << fileName << ", no hits" << std::endl;
+      continue;
+    }
+    if (fHasTimeRange && index.Load() && !IsInTimeRange(index)) continue;
     std::cout << "Loading hits from " << fileName << std::endl;
+    fStreams[slot] = std::make_unique<THitStream>(
+        fileName, fStreamFileType, fChSettingsVec, fStreamChunkSize);
+    if (!fStreams[slot]->IsEmpty()) return true;
+    fStreams[slot].reset();
   }
-  auto file = TFile::Open(fileName.c_str(), "READ");
-  if (!file) {
-    std::cerr << "File not found: " << fileName << std::endl;
-    return;
-  }
-  auto tree = dynamic_cast<TTree *>(file->Get("tout"));
-
-  tree->SetBranchStatus("*", kFALSE);
-  UShort_t brd;
-  tree->SetBranchStatus("Board", kTRUE);
-  tree->SetBranchAddress("Board", &brd);
-  UShort_t ch;
-  tree->SetBranchStatus("Channel", kTRUE);
-  tree->SetBranchAddress("Channel", &ch);
-
-  UShort_t ene;
-  tree->SetBranchStatus("Energy", kTRUE);
-  tree->SetBranchAddress("Energy", &ene);
-
-  UShort_t eneShort;
-  tree->SetBranchStatus("EnergyShort", kTRUE);
-  tree->SetBranchAddress("EnergyShort", &eneShort);
-
-  ULong64_t ts;
-  tree->SetBranchStatus("Timestamp", kTRUE);
-  tree->SetBranchAddress("Timestamp", &ts);
-
-  UInt_t flag;
-  tree->SetBranchStatus("Flags", kTRUE);
-  tree->SetBranchAddress("Flags", &flag);
-
-  auto hitsVec = std::vector<HitData_t>();
-  hitsVec.reserve(tree->GetEntries());
-  for (auto i = 0; i < tree->GetEntries(); i++) {
-    tree->GetEntry(i);
-    if (flag == 0) continue;
-    Double_t fineTS =
-        Double_t(ts) / 1000. + fChSettingsVec.at(brd).at(ch).timeOffset;
-    hitsVec.emplace_back(brd, ch, fineTS, ene, eneShort);
-
-    // std::cout << "brd: " << brd << " ch: " << ch << " ts: " << fineTS
-    //           << " ene: " << ene << " eneShort: " << eneShort << std::endl;
-  }
-
-  file->Close();
-  while (true) {
-    if (fInsertFlags[threadID]) {
-      break;
+
+  return false;
+}
+
+std::unique_ptr<THitStore> THitLoader::LoadNextHits(uint64_t nHits,
+                                                     uint32_t nThreads)
+{
+  auto hitVec = std::make_unique<THitStore>();
+  hitVec->reserve(nHits);
+
+  // Min-heap on the front timestamp of each open stream
+  auto comp = [this](const uint32_t a, const uint32_t b) {
+    return fStreams[a]->FrontTS() > fStreams[b]->FrontTS();
+  };
+
+  bool isSorted = true;
+  Timestamp_t lastTS = fLastStreamTS;
+  const auto nLateHits = fNLateHits;
+  while (hitVec->size() < nHits && fStreamHeap.size() > 0) {
+    std::pop_heap(fStreamHeap.begin(), fStreamHeap.end(), comp);
+    const auto slot = fStreamHeap.back();
+
+    // A newly opened file can start before the hits already merged, or a
+    // file is not sorted across its chunks.  Inside this chunk it is fixed
+    // by sorting, before the previous chunk it is lost for event building.
+    const auto ts = fStreams[slot]->FrontTS();
+    if (ts < fLastStreamTS) fNLateHits++;
+    if (ts < lastTS) isSorted = false;
+    lastTS = std::max(lastTS, ts);
+    fStreams[slot]->CopyFront(*hitVec);
+
+    fStreams[slot]->Pop();
+    if (fStreams[slot]->IsEmpty() && !OpenNextStream(slot)) {
+      fStreamHeap.pop_back();
+    } else {
+      std::push_heap(fStreamHeap.begin(), fStreamHeap.end(), comp);
     }
-    usleep(100);
   }
-  {
-    std::lock_guard<std::mutex> lock(fHitVecMutex);
-    fHitVec->insert(fHitVec->end(), hitsVec.begin(), hitsVec.end());
-    if (threadID + 1 < fInsertFlags.size()) fInsertFlags[threadID + 1] = true;
+  fLastStreamTS = lastTS;
+
+  if (!isSorted) {
+    hitVec->SortByTime(nThreads);
+  }
+  if (fNLateHits > nLateHits) {
+    std::cerr << fNLateHits - nLateHits
+              << " hits are older than the previous chunk.  Increase the "
+                 "number of files opened at the same time (-l)."
+              << std::endl;
   }
-  hitsVec.clear();
+
+  return hitVec;
 }
@@ -0,0 +1,66 @@
+#include "THitReader.hpp"
+
+#include <algorithm>
+
+#include "TCoMPASSReader.hpp"
+#include "THitFileReader.hpp"
+
+THitReader::THitReader(std::string fileName,
+                       const ChSettingsVec_t &chSettingsVec)
+    : fFileName(fileName), fChSettingsVec(chSettingsVec)
+{
+  fNBoards = fChSettingsVec.size();
+  for (const auto &mod : fChSettingsVec) {
+    fNChs = std::max<uint32_t>(fNChs, mod.size());
+  }
+  fTimeOffset.resize(fNBoards * fNChs, 0);
+  fIsKnownCh.resize(fNBoards * fNChs, false);
+  for (auto i = 0; i < fChSettingsVec.size(); i++) {
+    for (auto j = 0; j < fChSettingsVec[i].size(); j++) {
+      fTimeOffset[i * fNChs + j] =
+          NsToTicks(fChSettingsVec[i][j].timeOffset);
+      fIsKnownCh[i * fNChs + j] = true;
+    }
+  }
+}
+
+std::unique_ptr<THitReader> THitReader::Open(
+    std::string fileName, HitFileType fileType,
+    const ChSettingsVec_t &chSettingsVec)
+{
+  switch (fileType) {
+    case HitFileType::COMPASS:
+      return std::make_unique<TCoMPASSReader>(fileName, chSettingsVec);
+    default:
+      return std::make_unique<THitFileReader>(fileName, fileType,
+                                              chSettingsVec);
+  }
+}
+
+EntryRange_t THitReader::FindEntryRange(
+    Double_t from, Double_t to, const std::vector<EntryRange_t> &clusters)
+{
+  if (!IsOpen() || clusters.empty()) return EntryRange_t(0, 0);
+
+  // Index of the first cluster starting after ts
+  auto upperBound = [&](Double_t ts) {
+    std::size_t low = 0;
+    std::size_t high = clusters.size();
+    while (low < high) {
+      const auto mid = (low + high) / 2;
+      if (GetRawTS(clusters[mid].first) <= ts) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return low;
+  };
+
+  const auto first = upperBound(from);
+  const auto last = std::min(clusters.size(), upperBound(to) + 1);
+  const auto begin = (first < 2) ? 0 : first - 2;
+  if (begin >= last) return EntryRange_t(0, 0);
+
+  return EntryRange_t(clusters[begin].first, clusters[last - 1].second);
+}
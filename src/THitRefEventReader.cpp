@@ -0,0 +1,69 @@
+#include "THitRefEventReader.hpp"
+
+#include <iostream>
+
+THitRefEventReader::THitRefEventReader(std::string eventFileName,
+                                       std::string hitFileName)
+{
+  fEventFile = TFile::Open(eventFileName.c_str(), "READ");
+  fHitFile = TFile::Open(hitFileName.c_str(), "READ");
+  if (!fEventFile || !fHitFile) {
+    std::cerr << "File not found: " << eventFileName << " or " << hitFileName
+              << std::endl;
+    return;
+  }
+
+  fEventTree = dynamic_cast<TTree *>(fEventFile->Get("Event_Table"));
+  fHitTree = dynamic_cast<TTree *>(fHitFile->Get("Hit_Table"));
+  if (!IsOpen()) {
+    std::cerr << "No Event_Table or Hit_Table found" << std::endl;
+    return;
+  }
+
+  fEventTree->SetBranchAddress("TriggerID", &TriggerID);
+  fEventTree->SetBranchAddress("TriggerTS", &TriggerTS);
+  fEventTree->SetBranchAddress("Multiplicity", &Multiplicity);
+  fEventTree->SetBranchAddress("GammaMultiplicity", &GammaMultiplicity);
+  fEventTree->SetBranchAddress("EJMultiplicity", &EJMultiplicity);
+  fEventTree->SetBranchAddress("GSMultiplicity", &GSMultiplicity);
+  fEventTree->SetBranchAddress("IsFissionTrigger", &IsFissionTrigger);
+  fEventTree->SetBranchAddress("FirstHit", &FirstHit);
+  fEventTree->SetBranchAddress("NHits", &NHits);
+  fEventTree->SetBranchAddress("TriggerIndex", &TriggerIndex);
+
+  fHitTree->SetBranchAddress("Board", &fBoard);
+  fHitTree->SetBranchAddress("Channel", &fChannel);
+  fHitTree->SetBranchAddress("Timestamp", &fTimestamp);
+  fHitTree->SetBranchAddress("Energy", &fEnergy);
+  fHitTree->SetBranchAddress("EnergyShort", &fEnergyShort);
+}
+
+THitRefEventReader::~THitRefEventReader()
+{
+  if (fEventFile) {
+    fEventFile->Close();
+    delete fEventFile;
+  }
+  if (fHitFile) {
+    fHitFile->Close();
+    delete fHitFile;
+  }
+}
+
+Long64_t THitRefEventReader::GetEntries() const
+{
+  return fEventTree ? fEventTree->GetEntries() : 0;
+}
+
+void THitRefEventReader::GetEntry(Long64_t i)
+{
+  fEvent.clear();
+  if (!IsOpen()) return;
+
+  fEventTree->GetEntry(i);
+  for (auto k = FirstHit; k < FirstHit + NHits; k++) {
+    fHitTree->GetEntry(k);
+    fEvent.emplace_back(fBoard, fChannel, fTimestamp - TriggerTS, fEnergy,
+                        fEnergyShort);
+  }
+}
@@ -0,0 +1,303 @@
+#include "THitStore.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <parallel/algorithm>
+#include <thread>
+#include <utility>
+
+void THitStore::reserve(std::size_t n)
+{
+  Timestamp.reserve(n);
+  Board.reserve(n);
+  Channel.reserve(n);
+  Energy.reserve(n);
+  EnergyShort.reserve(n);
+}
+
+void THitStore::resize(std::size_t n)
+{
+  Timestamp.resize(n);
+  Board.resize(n);
+  Channel.resize(n);
+  Energy.resize(n);
+  EnergyShort.resize(n);
+}
+
+void THitStore::clear()
+{
+  Timestamp.clear();
+  Board.clear();
+  Channel.clear();
+  Energy.clear();
+  EnergyShort.clear();
+}
+
+void THitStore::Append(const THitStore &other, std::size_t first,
+                       std::size_t last)
+{
+  Timestamp.insert(Timestamp.end(), other.Timestamp.begin() + first,
+                   other.Timestamp.begin() + last);
+  Board.insert(Board.end(), other.Board.begin() + first,
+               other.Board.begin() + last);
+  Channel.insert(Channel.end(), other.Channel.begin() + first,
+                 other.Channel.begin() + last);
+  Energy.insert(Energy.end(), other.Energy.begin() + first,
+                other.Energy.begin() + last);
+  EnergyShort.insert(EnergyShort.end(), other.EnergyShort.begin() + first,
+                     other.EnergyShort.begin() + last);
+}
+
+void THitStore::CopyAt(std::size_t offset, const THitStore &other)
+{
+  std::copy(other.Timestamp.begin(), other.Timestamp.end(),
+            Timestamp.begin() + offset);
+  std::copy(other.Board.begin(), other.Board.end(), Board.begin() + offset);
+  std::copy(other.Channel.begin(), other.Channel.end(),
+            Channel.begin() + offset);
+  std::copy(other.Energy.begin(), other.Energy.end(), Energy.begin() + offset);
+  std::copy(other.EnergyShort.begin(), other.EnergyShort.end(),
+            EnergyShort.begin() + offset);
+}
+
+std::size_t THitStore::LowerBound(Timestamp_t ts) const
+{
+  auto it = std::lower_bound(Timestamp.begin(), Timestamp.end(), ts);
+  return std::distance(Timestamp.begin(), it);
+}
+
+bool THitStore::IsSorted() const
+{
+  return std::is_sorted(Timestamp.begin(), Timestamp.end());
+}
+
+// Blocks of ParallelFor: one when there are fewer items than threads
+static uint32_t GetNBlocks(std::size_t n, uint32_t nThreads)
+{
+  return (nThreads <= 1 || n < nThreads) ? 1 : nThreads;
+}
+
+// Split [0, n) into GetNBlocks(n, nThreads) blocks and run
+// func(block, begin, end) on each
+static void ParallelFor(
+    std::size_t n, uint32_t nThreads,
+    const std::function<void(uint32_t, std::size_t, std::size_t)> &func)
+{
+  const auto nBlocks = GetNBlocks(n, nThreads);
+  if (nBlocks == 1) {
+    func(0, 0, n);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < nBlocks; t++) {
+    threads.emplace_back(func, t, n * t / nBlocks, n * (t + 1) / nBlocks);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+typedef std::pair<Timestamp_t, uint64_t> SortKey_t;
+
+template <typename T>
+static void Gather(std::vector<T> &column, const std::vector<SortKey_t> &keys,
+                   uint32_t nThreads)
+{
+  std::vector<T> sorted(column.size());
+  ParallelFor(keys.size(), nThreads,
+              [&](uint32_t, std::size_t begin, std::size_t end) {
+                for (auto i = begin; i < end; i++) {
+                  sorted[i] = column[keys[i].second];
+                }
+              });
+  column.swap(sorted);
+}
+
+// Start of each time ordered run.  Empty when there are more than maxRuns.
+static std::vector<std::size_t> FindRuns(const std::vector<Timestamp_t> &ts,
+                                         uint32_t nThreads,
+                                         std::size_t maxRuns)
+{
+  std::vector<std::vector<std::size_t>> blockRuns(nThreads);
+  std::atomic<bool> isTooMany(false);
+  ParallelFor(ts.size(), nThreads,
+              [&](uint32_t t, std::size_t begin, std::size_t end) {
+                for (auto i = std::max<std::size_t>(begin, 1); i < end; i++) {
+                  if (ts[i] >= ts[i - 1]) continue;
+                  blockRuns[t].push_back(i);
+                  if (blockRuns[t].size() >= maxRuns) {
+                    isTooMany = true;
+                    return;
+                  }
+                }
+              });
+
+  std::vector<std::size_t> runs = {0};
+  if (isTooMany) return {};
+  for (const auto &block : blockRuns) {
+    runs.insert(runs.end(), block.begin(), block.end());
+  }
+  if (runs.size() > maxRuns) return {};
+
+  return runs;
+}
+
+// LSD radix sort on the key relative to the smallest key.  Only the digits
+// covering the time span of the keys are sorted.  Each pass counts the
+// digits per thread block, and the blocks scatter to their own offsets, so
+// the sort is stable.
+static void RadixSort(std::vector<SortKey_t> &keys, uint32_t nThreads)
+{
+  constexpr uint32_t kRadixBits = 11;
+  constexpr uint32_t kNBuckets = 1 << kRadixBits;
+  constexpr uint64_t kMask = kNBuckets - 1;
+
+  auto minKey = keys.front().first;
+  auto maxKey = keys.front().first;
+  for (const auto &key : keys) {
+    minKey = std::min(minKey, key.first);
+    maxKey = std::max(maxKey, key.first);
+  }
+  const uint64_t range = uint64_t(maxKey) - uint64_t(minKey);
+  uint32_t nPasses = 0;
+  while (nPasses * kRadixBits < 64 && (range >> (nPasses * kRadixBits)) > 0) {
+    nPasses++;
+  }
+
+  // One row of counts per block actually run
+  const auto nBlocks = GetNBlocks(keys.size(), nThreads);
+  std::vector<SortKey_t> buffer(keys.size());
+  std::vector<std::vector<uint64_t>> counts(
+      nBlocks, std::vector<uint64_t>(kNBuckets));
+  for (uint32_t pass = 0; pass < nPasses; pass++) {
+    const auto shift = pass * kRadixBits;
+    auto digit = [&](const SortKey_t &key) {
+      return ((uint64_t(key.first) - uint64_t(minKey)) >> shift) & kMask;
+    };
+
+    ParallelFor(keys.size(), nThreads,
+                [&](uint32_t t, std::size_t begin, std::size_t end) {
+                  std::fill(counts[t].begin(), counts[t].end(), 0);
+                  for (auto i = begin; i < end; i++) {
+                    counts[t][digit(keys[i])]++;
+                  }
+                });
+
+    // Offset of digit d of block t: all smaller digits, then the same digit
+    // of the blocks before t
+    uint64_t offset = 0;
+    for (uint32_t d = 0; d < kNBuckets; d++) {
+      for (uint32_t t = 0; t < nBlocks; t++) {
+        const auto count = counts[t][d];
+        counts[t][d] = offset;
+        offset += count;
+      }
+    }
+
+    ParallelFor(keys.size(), nThreads,
+                [&](uint32_t t, std::size_t begin, std::size_t end) {
+                  for (auto i = begin; i < end; i++) {
+                    buffer[counts[t][digit(keys[i])]++] = keys[i];
+                  }
+                });
+    keys.swap(buffer);
+  }
+}
+
+void THitStore::SortByTime(uint32_t nThreads)
+{
+  if (empty()) return;
+  nThreads = std::max(1u, nThreads);
+
+  const auto runs = FindRuns(Timestamp, nThreads, kMaxMergeRuns);
+  if (runs.size() == 1) return;
+
+  std::vector<SortKey_t> keys(size());
+  ParallelFor(size(), nThreads,
+              [&](uint32_t, std::size_t begin, std::size_t end) {
+                for (auto i = begin; i < end; i++) {
+                  keys[i] = std::make_pair(Timestamp[i], i);
+                }
+              });
+
+  auto comp = [](const SortKey_t &a, const SortKey_t &b) {
+    return a.first < b.first;
+  };
+  if (runs.size() > 0) {
+    // A few sorted runs, e.g. sorted files one after another: one k-way merge
+    std::vector<std::pair<SortKey_t *, SortKey_t *>> seqs;
+    for (auto i = 0; i < runs.size(); i++) {
+      const auto end = (i + 1 < runs.size()) ? runs[i + 1] : size();
+      seqs.emplace_back(keys.data() + runs[i], keys.data() + end);
+    }
+    std::vector<SortKey_t> merged(size());
+    if (nThreads > 1) {
+      __gnu_parallel::stable_multiway_merge(
+          seqs.begin(), seqs.end(), merged.begin(), size(), comp,
+          __gnu_parallel::parallel_tag(nThreads));
+    } else {
+      __gnu_parallel::stable_multiway_merge(seqs.begin(), seqs.end(),
+                                            merged.begin(), size(), comp,
+                                            __gnu_parallel::sequential_tag());
+    }
+    keys.swap(merged);
+  } else {
+    RadixSort(keys, nThreads);
+  }
+
+  ParallelFor(size(), nThreads,
+              [&](uint32_t, std::size_t begin, std::size_t end) {
+                for (auto i = begin; i < end; i++) Timestamp[i] = keys[i].first;
+              });
+  Gather(Board, keys, nThreads);
+  Gather(Channel, keys, nThreads);
+  Gather(Energy, keys, nThreads);
+  Gather(EnergyShort, keys, nThreads);
+}
+
+// Replace the first n elements of v with head (head.size() >= n).  One
+// move of the tail, no element by element copy.
+template <typename T>
+static void ReplaceHead(std::vector<T> &v, std::size_t n,
+                        const std::vector<T> &head)
+{
+  v.insert(v.begin() + n, head.begin() + n, head.end());
+  std::copy(head.begin(), head.begin() + n, v.begin());
+}
+
+void THitStore::MergeFront(const THitStore &carry)
+{
+  if (carry.empty()) return;
+  if (empty()) {
+    Append(carry);
+    return;
+  }
+
+  // Only the carried hits after the first hit here, and the hits here
+  // before the last carried hit, overlap.  The carry goes first at ties.
+  const auto carryBegin = carry.LowerBound(Timestamp.front() + 1);
+  const auto nOverlap = LowerBound(carry.Timestamp.back());
+
+  THitStore head;
+  head.reserve(carry.size() + nOverlap);
+  head.Append(carry, 0, carryBegin);
+  auto i = carryBegin;
+  std::size_t j = 0;
+  while (i < carry.size() && j < nOverlap) {
+    if (Timestamp[j] < carry.Timestamp[i]) {
+      head.PushBack(*this, j++);
+    } else {
+      head.PushBack(carry, i++);
+    }
+  }
+  head.Append(carry, i, carry.size());
+  head.Append(*this, j, nOverlap);
+
+  ReplaceHead(Timestamp, nOverlap, head.Timestamp);
+  ReplaceHead(Board, nOverlap, head.Board);
+  ReplaceHead(Channel, nOverlap, head.Channel);
+  ReplaceHead(Energy, nOverlap, head.Energy);
+  ReplaceHead(EnergyShort, nOverlap, head.EnergyShort);
+}
@@ -0,0 +1,39 @@
+#include "THitStream.hpp"
+
+#include <algorithm>
+
+THitStream::THitStream(std::string fileName, HitFileType fileType,
+                       const ChSettingsVec_t &chSettingsVec,
+                       uint32_t chunkSize)
+    : fReader(THitReader::Open(fileName, fileType, chSettingsVec)),
+      fChunkSize(chunkSize)
+{
+  fChunk.reserve(fChunkSize);
+  FillChunk();
+}
+
+void THitStream::Pop()
+{
+  fPos++;
+  if (IsEmpty()) FillChunk();
+}
+
+bool THitStream::FillChunk()
+{
+  fChunk.clear();
+  fPos = 0;
+
+  // Loop until something is read.  ELIGANT chunks can be empty after the
+  // flag selection.
+  while (fChunk.empty() && fNextEntry < fReader->GetEntries()) {
+    const auto lastEntry =
+        std::min(fReader->GetEntries(), fNextEntry + fChunkSize);
+    fReader->Read(fNextEntry, lastEntry, fChunk);
+    fNextEntry = lastEntry;
+  }
+
+  // Nearly sorted already.  Cheap compared with sorting the whole batch.
+  fChunk.SortByTime();
+
+  return !fChunk.empty();
+}
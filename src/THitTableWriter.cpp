@@ -0,0 +1,51 @@
+#include "THitTableWriter.hpp"
+
+#include <chrono>
+
+THitTableWriter::THitTableWriter(std::string fileName,
+                                 WriteSettings_t settings)
+    : fFileName(fileName)
+{
+  fFile = TFile::Open(fFileName.c_str(), "RECREATE");
+  ApplyWriteSettings(fFile, settings);
+  fTree = new TTree("Hit_Table", "Hit Table");
+  fTree->Branch("Board", &fBoard);
+  fTree->Branch("Channel", &fChannel);
+  fTree->Branch("Timestamp", &fTimestamp);
+  fTree->Branch("Energy", &fEnergy);
+  fTree->Branch("EnergyShort", &fEnergyShort);
+  ApplyWriteSettings(fTree, settings);
+  fTree->SetDirectory(fFile);
+}
+
+THitTableWriter::~THitTableWriter() { Close(); }
+
+void THitTableWriter::Write(const THitStore &hits, std::size_t first)
+{
+  const auto start = std::chrono::steady_clock::now();
+
+  for (auto i = first; i < hits.size(); i++) {
+    fBoard = hits.Board[i];
+    fChannel = hits.Channel[i];
+    fTimestamp = TicksToNs(hits.Timestamp[i]);
+    fEnergy = hits.Energy[i];
+    fEnergyShort = hits.EnergyShort[i];
+    fTree->Fill();
+  }
+  fNEntries += hits.size() - first;
+
+  fBusyTime += std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+}
+
+void THitTableWriter::Close()
+{
+  if (!fFile) return;
+
+  fFile->cd();
+  fTree->Write();
+  fFile->Close();
+  delete fFile;
+  fFile = nullptr;
+}
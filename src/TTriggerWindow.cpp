@@ -0,0 +1,76 @@
+#include "TTriggerWindow.hpp"
+
+#include <algorithm>
+
+TTriggerWindow::TTriggerWindow(const THitStore &hits,
+                               const TChannelTable &channelTable,
+                               Double_t timeWindow)
+    : fHits(hits),
+      fChannelTable(channelTable),
+      fHalfWindow(NsToTicks(timeWindow / 2))
+{
+  fTriggerCount.resize(fChannelTable.GetNDetectorIDs(), 0);
+  fLastTriggerHit.resize(fChannelTable.GetNDetectorIDs(), -1);
+  fBoardCount.resize(fChannelTable.GetNBoards(), 0);
+}
+
+int32_t TTriggerWindow::GetTriggerDetectorID(std::size_t k) const
+{
+  const auto &info = fChannelTable.Get(fHits.Board[k], fHits.Channel[k]);
+  if (info.isEventTrigger && info.detectorID >= 0) {
+    return info.detectorID;
+  }
+  return -1;
+}
+
+void TTriggerWindow::Add(std::size_t k)
+{
+  auto id = GetTriggerDetectorID(k);
+  if (id >= 0) fTriggerCount[id]++;
+  fBoardCount[fHits.Board[k]]++;
+}
+
+void TTriggerWindow::Remove(std::size_t k)
+{
+  auto id = GetTriggerDetectorID(k);
+  if (id >= 0) fTriggerCount[id]--;
+  fBoardCount[fHits.Board[k]]--;
+}
+
+void TTriggerWindow::MoveTo(std::size_t j)
+{
+  const auto ts = fHits.Timestamp[j];
+  if (!fIsInit) {
+    fBegin = fEnd = fNext = fHits.LowerBound(ts - fHalfWindow);
+    fIsInit = true;
+  }
+
+  while (fEnd < fHits.size() && fHits.Timestamp[fEnd] <= ts + fHalfWindow) {
+    Add(fEnd++);
+  }
+  while (fHits.Timestamp[fBegin] < ts - fHalfWindow) {
+    Remove(fBegin++);
+  }
+  for (; fNext < j; fNext++) {
+    auto id = GetTriggerDetectorID(fNext);
+    if (id >= 0) fLastTriggerHit[id] = fNext;
+  }
+}
+
+bool TTriggerWindow::IsRejected(int32_t triggerID) const
+{
+  if (triggerID < 0) return false;
+
+  // Same detector in the past (the trigger itself is not in fLastTriggerHit)
+  if (triggerID < fLastTriggerHit.size() &&
+      fLastTriggerHit[triggerID] >= int64_t(fBegin)) {
+    return true;
+  }
+
+  const auto nIDs = std::min<std::size_t>(triggerID, fTriggerCount.size());
+  for (std::size_t id = 0; id < nIDs; id++) {
+    if (fTriggerCount[id] > 0) return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,52 @@
+#include "TWorkStealingQueue.hpp"
+
+TWorkStealingQueue::TWorkStealingQueue(uint64_t nChunks, uint32_t nThreads)
+{
+  if (nThreads == 0) nThreads = 1;
+  for (auto i = 0; i < nThreads; i++) {
+    auto range = std::make_unique<ChunkRange>();
+    range->begin = nChunks * i / nThreads;
+    range->end = nChunks * (i + 1) / nThreads;
+    fRanges.push_back(std::move(range));
+  }
+}
+
+bool TWorkStealingQueue::Pop(uint32_t threadID, uint64_t &chunk)
+{
+  {
+    auto &range = fRanges.at(threadID);
+    std::lock_guard<std::mutex> lock(range->mutex);
+    if (range->begin < range->end) {
+      chunk = range->begin++;
+      return true;
+    }
+  }
+
+  return Steal(chunk);
+}
+
+bool TWorkStealingQueue::Steal(uint64_t &chunk)
+{
+  while (true) {
+    // The victim can be emptied by its owner before it is locked again.
+    // Then look for another one.
+    uint32_t victim = 0;
+    uint64_t nLeft = 0;
+    for (auto i = 0; i < fRanges.size(); i++) {
+      std::lock_guard<std::mutex> lock(fRanges[i]->mutex);
+      auto n = fRanges[i]->end - fRanges[i]->begin;
+      if (n > nLeft) {
+        nLeft = n;
+        victim = i;
+      }
+    }
+    if (nLeft == 0) return false;
+
+    auto &range = fRanges[victim];
+    std::lock_guard<std::mutex> lock(range->mutex);
+    if (range->begin < range->end) {
+      chunk = --range->end;
+      return true;
+    }
+  }
+}
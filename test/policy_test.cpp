@@ -0,0 +1,150 @@
+// Event flags of the policies with the shipped chSettings.json, against
+// the classification of the builder before the detector categories.
+// Usage: policy-test [channel settings]
+// Random windows of hits follow each trigger channel.  Multiplicities and
+// IsFissionTrigger must be those of the old code.
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TChannelTable.hpp"
+#include "TEventPolicy.hpp"
+
+struct Flags_t {
+  uint32_t gamma = 0;
+  uint32_t ej = 0;
+  uint32_t gs = 0;
+  bool isFissionTrigger = false;
+
+  bool operator==(const Flags_t &other) const
+  {
+    return gamma == other.gamma && ej == other.ej && gs == other.gs &&
+           isFissionTrigger == other.isFissionTrigger;
+  };
+};
+
+// Window of hits, (board, channel, adc).  The trigger is the first hit.
+struct Hit_t {
+  uint32_t brd;
+  uint32_t ch;
+  UShort_t adc;
+};
+
+// The old fission builder: every hit in the category of the trigger ID
+static Flags_t OldFission(const TChannelTable &table,
+                          const std::vector<Hit_t> &hits)
+{
+  const auto triggerID = table.Get(hits[0].brd, hits[0].ch).detectorID;
+  Flags_t flags;
+  double eneSum = 0.;
+  for (const auto &hit : hits) {
+    eneSum += table.Get(hit.brd, hit.ch).GetCalibratedEnergy(hit.adc);
+    if (31 < triggerID && triggerID < 66) {
+      flags.gamma++;
+    } else if (79 < triggerID && triggerID < 117) {
+      flags.ej++;
+    } else if (118 < triggerID && triggerID < 144) {
+      flags.gs++;
+    }
+  }
+  flags.isFissionTrigger = hits.size() > 2 && eneSum > 1000 && flags.gamma > 0;
+  return flags;
+}
+
+// The old ELIGANT builder: the trigger by its ID, the others by board * 16
+// + channel
+static Flags_t OldELIGANT(const TChannelTable &table,
+                          const std::vector<Hit_t> &hits)
+{
+  const auto triggerID = table.Get(hits[0].brd, hits[0].ch).detectorID;
+  Flags_t flags;
+  double eneSum = 0.;
+  for (auto k = 0; k < hits.size(); k++) {
+    const auto &hit = hits[k];
+    eneSum += table.Get(hit.brd, hit.ch).GetCalibratedEnergy(hit.adc);
+    const int32_t id = (k == 0) ? triggerID : hit.brd * 16 + hit.ch;
+    if (id < 34) {
+      flags.gamma++;
+    } else if (47 < id && id < 85) {
+      flags.ej++;
+    } else if (86 < id && id < 112) {
+      flags.gs++;
+    }
+  }
+  flags.isFissionTrigger = hits.size() > 2 && eneSum > 1000 && flags.gamma > 0;
+  return flags;
+}
+
+// As TEventBuilder::SearchEvents
+template <class Policy>
+static Flags_t New(const TChannelTable &table, const std::vector<Hit_t> &hits)
+{
+  const auto &trgInfo = table.Get(hits[0].brd, hits[0].ch);
+  uint32_t nHits[kNCategories] = {};
+  double eneSum = 0.;
+  for (const auto &hit : hits) {
+    const auto &info = table.Get(hit.brd, hit.ch);
+    eneSum += info.GetCalibratedEnergy(hit.adc);
+    nHits[Policy::Classify(info, trgInfo)]++;
+  }
+  Flags_t flags;
+  flags.gamma = nHits[kGamma];
+  flags.ej = nHits[kEJ];
+  flags.gs = nHits[kGS];
+  flags.isFissionTrigger =
+      Policy::IsFissionTrigger(hits.size(), eneSum, nHits[kGamma]);
+  return flags;
+}
+
+int main(int argc, char *argv[])
+{
+  std::string fileName = "chSettings.json";
+  if (argc > 1) fileName = argv[1];
+  const auto chSettingsVec = TChSettings::GetChSettings(fileName);
+  if (chSettingsVec.empty()) return 1;
+  const TChannelTable table(chSettingsVec);
+
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<uint32_t> randomSize(1, 12);
+  std::uniform_int_distribution<uint32_t> randomBrd(0, chSettingsVec.size() -
+                                                           1);
+  std::uniform_int_distribution<UShort_t> randomADC(0, 1000);
+
+  uint64_t nEvents = 0;
+  uint64_t nFission = 0;
+  uint64_t nFailed = 0;
+  for (uint32_t brd = 0; brd < chSettingsVec.size(); brd++) {
+    for (uint32_t ch = 0; ch < chSettingsVec[brd].size(); ch++) {
+      if (!table.Get(brd, ch).isEventTrigger) continue;
+      for (auto trial = 0; trial < 1000; trial++) {
+        std::vector<Hit_t> hits = {{brd, ch, randomADC(rng)}};
+        const auto size = randomSize(rng);
+        while (hits.size() < size) {
+          const auto hitBrd = randomBrd(rng);
+          std::uniform_int_distribution<uint32_t> randomCh(
+              0, chSettingsVec[hitBrd].size() - 1);
+          hits.push_back({hitBrd, randomCh(rng), randomADC(rng)});
+        }
+
+        const auto fission = OldFission(table, hits);
+        if (!(New<TFissionPolicy>(table, hits) == fission)) nFailed++;
+        if (!(New<TELIGANTPolicy>(table, hits) == OldELIGANT(table, hits))) {
+          nFailed++;
+        }
+        nFission += fission.isFissionTrigger;
+        nEvents++;
+      }
+    }
+  }
+
+  std::cout << nEvents << " windows, " << nFission << " fission triggers"
+            << std::endl;
+  if (nFailed > 0) {
+    std::cerr << nFailed << " windows differ from the old builder"
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,63 @@
+// THitStore::SortByTime of small stores with many descents.  Fewer hits
+// than threads run in one block, and the radix sort must not use the
+// counts of the blocks that did not run.
+// Usage: sort-test
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "THitStore.hpp"
+
+// More threads than hits
+static constexpr uint32_t kNThreads = 64;
+
+// Stable sort of the columns, by an index permutation
+static THitStore ReferenceSort(const THitStore &hits)
+{
+  std::vector<std::size_t> order(hits.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](const std::size_t a, const std::size_t b) {
+                     return hits.Timestamp[a] < hits.Timestamp[b];
+                   });
+
+  THitStore sorted;
+  for (const auto i : order) sorted.PushBack(hits, i);
+  return sorted;
+}
+
+int main()
+{
+  std::mt19937_64 rng(42);
+  uint32_t nFailed = 0;
+  for (uint32_t nHits = 20; nHits <= 40; nHits++) {
+    for (uint32_t trial = 0; trial < 100; trial++) {
+      // Decreasing timestamps over several 11 bit digits: more descents
+      // than kMaxMergeRuns, so the radix sort runs.  Some are equal.
+      std::uniform_int_distribution<Timestamp_t> randomStep(0, 100000);
+      THitStore hits;
+      Timestamp_t ts = Timestamp_t(1) << 30;
+      for (uint32_t i = 0; i < nHits; i++) {
+        hits.emplace_back(i % 11, i % 16, ts, i, i / 2);
+        if (i % 7 != 0) ts -= randomStep(rng) + 1;
+      }
+      const auto expected = ReferenceSort(hits);
+
+      hits.SortByTime(kNThreads);
+      if (hits.Timestamp != expected.Timestamp ||
+          hits.Energy != expected.Energy) {
+        nFailed++;
+      }
+    }
+  }
+
+  if (nFailed > 0) {
+    std::cerr << nFailed << " sorts failed" << std::endl;
+    return 1;
+  }
+  std::cout << "All sorts passed" << std::endl;
+  return 0;
+}